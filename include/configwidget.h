@@ -19,17 +19,52 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #ifndef CONFIGWIDGET_H
 #define CONFIGWIDGET_H
 
-#include <QWidget>
-#include <QDockWidget>
-#include <QtGui>
-#include <QSplitter>
 #include <QStringList>
-#include <QMainWindow>
 #include <QSettings>
 
 #include <cstdint>
 #include <cstdio>
 #include <memory>
+#include <string>
+
+#ifdef FIRASIM_HEADLESS
+
+//Without VarTypes every value is a plain member, read once from an ini file
+//where keys are the member names (e.g. DeltaTime=0.016, DivB_Field_Length=1.5).
+
+class VarList {
+public:
+    explicit VarList(const char*) {}
+    template <typename T> void addChild(const T&) {}
+};
+typedef std::shared_ptr<VarList> VarListPtr;
+
+#define DEF_VALUE(type,Type,name)  \
+            type v_##name; \
+            inline type name() {return v_##name;} \
+            inline void set_##name(type value) {v_##name = value;}
+
+#define DEF_FIELD_VALUE(type,Type,name)  \
+            type v_DivA_##name; \
+            type v_DivB_##name; \
+            inline type name() {return (Division() == "Division A" ? v_DivA_##name: v_DivB_##name); }
+
+#define DEF_ENUM(type,name)  \
+            type v_##name; \
+            type name() {return v_##name;}
+
+#define DEF_TREE(name)  \
+            VarListPtr name;
+#define DEF_PTREE(parents, name)  \
+            VarListPtr parents##_##name;
+
+#else
+
+#include <QWidget>
+#include <QDockWidget>
+#include <QtGui>
+#include <QSplitter>
+#include <QMainWindow>
 
 #include <vartypes/VarTreeModel.h>
 #include <vartypes/VarItem.h>
@@ -50,7 +85,8 @@ using namespace VarTypes;
 
 #define DEF_VALUE(type,Type,name)  \
             std::shared_ptr<VarTypes::Var##Type> v_##name; \
-            inline type name() {return v_##name->get##Type();}
+            inline type name() {return v_##name->get##Type();} \
+            inline void set_##name(type value) {v_##name->set##Type(value);}
             
 #define DEF_FIELD_VALUE(type,Type,name)  \
             std::shared_ptr<VarTypes::Var##Type> v_DivA_##name; \
@@ -71,7 +107,8 @@ using namespace VarTypes;
 
 #define DEF_VALUE(type,Type,name)  \
             std::shared_ptr<VarTypes::Var##Type> v_##name; \
-            inline type name() {return v_##name->get##Type();}
+            inline type name() {return v_##name->get##Type();} \
+            inline void set_##name(type value) {v_##name->set##Type(value);}
 
 #define DEF_FIELD_VALUE(type,Type,name)  \
             std::shared_ptr<VarTypes::Var##Type> v_DivA_##name; \
@@ -89,6 +126,8 @@ using namespace VarTypes;
 
 #endif
 
+#endif // FIRASIM_HEADLESS
+
 
 class RobotSettings {
 public:
@@ -112,6 +151,19 @@ public:
 };
 
 
+#ifdef FIRASIM_HEADLESS
+class ConfigWidget : public QObject
+{
+  Q_OBJECT
+
+protected:
+  std::vector<VarListPtr> world;
+public:
+  VarListPtr geo_vars;
+  //values missing from file (or every value, if file is empty) keep their defaults
+  ConfigWidget(bool forceDivisionA = false, const QString& file = QString());
+  ~ConfigWidget() override;
+#else
 class ConfigWidget : public VarTreeView
 {
   Q_OBJECT
@@ -123,6 +175,7 @@ public:
   VarListPtr geo_vars;
   ConfigWidget(bool forceDivisionA = false);
   ~ConfigWidget() override;
+#endif
 
   QSettings* robot_settings;
   RobotSettings robotSettings{};
@@ -163,12 +216,29 @@ public:
   DEF_VALUE(bool, Bool, SyncWithPython)
   DEF_VALUE(double,Double,DesiredFPS)
   DEF_VALUE(double,Double,DeltaTime)
+  DEF_VALUE(bool,Bool,FreeRunning)
+  DEF_VALUE(double,Double,RealTimeFactor)
+  DEF_VALUE(int,Int,Seed)
+  DEF_ENUM(std::string,PhysicsProfile)
+  DEF_VALUE(int,Int,Substeps)
+  DEF_VALUE(bool,Bool,AdaptiveSubsteps)
+  DEF_VALUE(int,Int,MinSubsteps)
+  DEF_VALUE(double,Double,AdaptiveSpeedThreshold)
+  DEF_VALUE(bool,Bool,QuickStep)
+  DEF_VALUE(int,Int,SolverIterations)
+  DEF_VALUE(int,Int,ODEThreads)
+  DEF_VALUE(int,Int,CollideThreads)
+  DEF_VALUE(bool,Bool,AutoDisable)
+  DEF_ENUM(std::string,Broadphase)
   DEF_VALUE(int,Int,sendGeometryEvery)
   DEF_VALUE(double,Double,Gravity)
   DEF_VALUE(bool,Bool,ResetTurnOver)
   DEF_VALUE(std::string,String,VisionMulticastAddr)  
   DEF_VALUE(int,Int,VisionMulticastPort)  
   DEF_VALUE(int,Int,CommandListenPort)
+  DEF_VALUE(int,Int,SimulatePort)
+  DEF_VALUE(std::string,String,SharedMemoryName)
+  DEF_VALUE(std::string,String,RecordFile)
   DEF_VALUE(int,Int,BlueStatusSendPort)
   DEF_VALUE(int,Int,YellowStatusSendPort)
   DEF_VALUE(int,Int,sendDelay)
@@ -186,8 +256,10 @@ public:
   void loadRobotSettings(const QString&& team);
 public slots:  
   void loadRobotsSettings();
+  void applyPhysicsProfile();
 };
 
+#ifndef FIRASIM_HEADLESS
 class ConfigDockWidget : public QDockWidget
 {
     Q_OBJECT
@@ -200,5 +272,6 @@ class ConfigDockWidget : public QDockWidget
   signals:
     void closeSignal(bool);
 };
+#endif
 
 #endif // CONFIGWIDGET_H
@@ -23,8 +23,15 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #include <ode/ode.h>
 
 #include <QVector>
-#include <QGLWidget>
 #include <QString>
+#ifdef FIRASIM_HEADLESS
+//the headless core links no QtGui/QtOpenGL, every CGraphics call is a no-op
+class QGLWidget;
+class QImage;
+typedef unsigned int GLuint;
+#else
+#include <QGLWidget>
+#endif
 
 
 class CGraphics
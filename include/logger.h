@@ -20,7 +20,12 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #define LOGGER_H
 
 #include <QString>
+#ifdef FIRASIM_HEADLESS
+//no QtGui in the headless core, colours are only names there
+typedef QString QColor;
+#else
 #include <QColor>
+#endif
 
 void initLogger(void*); //MUST BE INITED FROM MAINWINDOW.CPP
 void logStatus(QString s,QColor c);
@@ -27,6 +27,8 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #include "configwidget.h"
 #include "statuswidget.h"
 #include "robotwidget.h"
+#include "net/simulate_server.h"
+#include "simthread.h"
 
 class MainWindow : public QMainWindow
 {
@@ -60,11 +62,20 @@ public slots:
     void showAbout();
     void reconnectCommandSocket();
     void reconnectVisionSocket();
+    void reconnectSimulateServer();
+    void reconnectSharedMemory();
+    void reconnectRecorder();
+    void showProfilerReport();
     void recvActions();
     void sendBuffer();
     void setIsGlEnabled(bool value);
     void withGoalKick(bool value);
     void fullSpeed(bool value);
+    void changeFreeRunning();
+    void changeSeed();
+    void setSeed(int seed);
+    void changeODEThreads();
+    void changeCollideThreads();
 
     int robotIndex(int robot,int team);
 private:
@@ -89,6 +100,10 @@ private:
     QSize lastSize;
     RoboCupSSLServer *visionServer;
     QUdpSocket *commandSocket;
+    SimulateServer *simulateServer;
+    ShmChannel *shmChannel;
+    MatchRecorder *recorder;
+    SimThread *simThread;
 };
 
 #endif // MAINWINDOW_H
@@ -48,6 +48,7 @@ public:
     ~RoboCupSSLServer();
 
     bool send(const fira_message::sim_to_ref::Environment & env);
+    bool send(const QByteArray & datagram);
     void change_port(const quint16 &port);
     void change_address(const string & net_address);
     void change_interface(const string & net_interface);
@@ -58,6 +59,7 @@ protected:
     quint16 _port;
     QHostAddress * _net_address;
     QNetworkInterface * _net_interface;
+    QByteArray _buffer;
 };
 
 #endif
@@ -0,0 +1,100 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHM_CHANNEL_H
+#define SHM_CHANNEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "packet.pb.h"
+
+// Shared-memory state/command channel for controllers running on the same host.
+// The simulator publishes every frame into one segment guarded by a seqlock and
+// drains robot commands from a single-producer single-consumer ring in the same
+// segment. Everything is plain fixed-layout data, nothing is serialized.
+
+#define SHM_MAGIC 0x46495241u   //"FIRA"
+#define SHM_VERSION 1
+#define SHM_MAX_ROBOTS 12
+#define SHM_COMMAND_RING 256    //power of two
+
+struct ShmBall
+{
+    double x, y, z, vx, vy;
+};
+
+struct ShmRobot
+{
+    uint32_t robot_id;
+    uint32_t present;           //0 when switched off or vanished this frame
+    double x, y, orientation, vx, vy, vorientation;
+};
+
+struct ShmState
+{
+    uint32_t step;              //simulation time in ms, as Environment.step
+    uint32_t goals_blue, goals_yellow;
+    uint32_t robots_per_team;
+    ShmBall ball;
+    ShmRobot blue[SHM_MAX_ROBOTS];
+    ShmRobot yellow[SHM_MAX_ROBOTS];
+};
+
+struct ShmCommand
+{
+    uint32_t robot_id;
+    uint32_t yellowteam;
+    double wheel_left, wheel_right;
+};
+
+struct ShmSegment
+{
+    uint32_t magic, version;
+    alignas(64) std::atomic<uint32_t> sequence;     //odd while the state is being written
+    ShmState state;
+    alignas(64) std::atomic<uint32_t> command_head; //written by the controller
+    alignas(64) std::atomic<uint32_t> command_tail; //written by the simulator
+    ShmCommand commands[SHM_COMMAND_RING];
+};
+
+class ShmChannel
+{
+public:
+    ShmChannel();
+    ~ShmChannel();
+    // the simulator creates the segment, controllers attach to it
+    bool open(const std::string &name, bool create);
+    void close();
+    bool isOpen() const;
+
+    // simulator side
+    void publish(const fira_message::sim_to_ref::Environment &env, int robots_per_team);
+    bool popCommand(ShmCommand &cmd);
+
+    // controller side
+    uint32_t readState(ShmState &state) const;  //returns the sequence of the copy, 0 when not open
+    bool pushCommand(const ShmCommand &cmd);
+private:
+    ShmSegment *segment;
+    std::string segment_name;
+    bool owner;
+};
+
+#endif // SHM_CHANNEL_H
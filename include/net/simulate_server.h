@@ -0,0 +1,59 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIMULATE_SERVER_H
+#define SIMULATE_SERVER_H
+
+#include <QObject>
+#include <QByteArray>
+
+#include "packet.pb.h"
+
+class QTcpServer;
+class QTcpSocket;
+class SSLWorld;
+
+// Lock-step implementation of the Simulate service declared in packet.proto.
+// Each request is a Packet and each reply the Environment of exactly one step,
+// both framed on a TCP stream as a 4 byte big-endian length followed by the message.
+// While a client is connected the world is only stepped by its requests.
+class SimulateServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SimulateServer(QObject *parent = nullptr);
+    ~SimulateServer() override;
+    bool listen(quint16 port);
+    void close();
+    void setWorld(SSLWorld *w);
+    bool hasClient() const;
+private slots:
+    void acceptClient();
+    void readRequests();
+    void dropClient();
+private:
+    void reply(const fira_message::sim_to_ref::Environment &env);
+    QTcpServer *server;
+    QTcpSocket *client;
+    SSLWorld *world;
+    QByteArray in_buffer, out_buffer;
+    fira_message::sim_to_ref::Packet request;
+    fira_message::sim_to_ref::Environment response;
+};
+
+#endif // SIMULATE_SERVER_H
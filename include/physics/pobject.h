@@ -21,6 +21,20 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #include <ode/ode.h>
 #include "graphics.h"
 
+//collision class of an object; each class is one ODE category bit and surfaces
+//are defined between classes, so pairs without a surface never reach nearCallback
+enum PClass
+{
+    PClassGround,
+    PClassWall,
+    PClassBall,
+    PClassRay,
+    PClassChassis,
+    PClassWheel,
+    PClassCaster,
+    PClassCount
+};
+
 class PObject
 {
 private:
@@ -60,6 +74,7 @@ public:
     CGraphics *graphics{};
     int tag;
     int id{};
+    PClass cls{};
 };
 
 #endif // POBJECT_H
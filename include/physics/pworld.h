@@ -22,31 +22,130 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #include "pobject.h"
 #include <QMap>
 #include <QVector>
+#include <QPair>
+#include <cstdint>
+
+#define PWORLD_MAX_CONTACTS 10 //contacts kept per geom pair
+#define PWORLD_PARALLEL_MIN_PAIRS 16 //fewer pairs are cheaper to collide on the stepping thread
 
 class PSurface;
+class ThreadPool;
+
+//candidate pair from the broadphase, ordered by the ids of its objects
+struct PGeomPair
+{
+    int a, b;
+    dGeomID o1, o2;
+    bool operator<(const PGeomPair &other) const
+    {
+        return a < other.a || (a == other.a && b < other.b);
+    }
+};
+
+//dynamic state of one body, as saved by PWorld::saveBodies
+struct PBodyState
+{
+    dReal pos[3];
+    dQuaternion q;
+    dReal lvel[3], avel[3];
+    int enabled;
+};
+
+enum PBroadphaseType
+{
+    PBroadphaseHash,        //dHashSpace
+    PBroadphaseSAP,         //dSweepAndPruneSpace
+    PBroadphaseQuadTree,    //dQuadTreeSpace over the field
+    PBroadphaseGrid         //dSimpleSpace with PWorld's own 2D uniform grid
+};
+
+//broadphase and the area it has to cover, geoms outside it (planes, rays) are tested against all
+struct PBroadphase
+{
+    PBroadphaseType type = PBroadphaseHash;
+    dReal half_length = 2, half_width = 2;
+    dReal cell = 0.2;
+};
+
+//per-world counters, reset by the caller
+struct PCollisionStats
+{
+    uint64_t aabb_tests;        //grid only, ODE spaces do not report theirs
+    uint64_t candidate_pairs;   //pairs handed over by the broadphase
+    uint64_t surface_pairs;     //candidates with a surface, narrowphase was run on them
+    uint64_t contact_pairs;     //narrowphase found at least one contact
+};
+
+//one geom as the grid broadphase sees it
+struct PGridGeom
+{
+    dGeomID geom;
+    dReal aabb[6];
+};
+
 class PWorld
 {
 private:
+    PBroadphase broadphase;
+    QVector<PGridGeom> grid_geoms;
+    QVector<int> grid_unbounded;
+    QVector<QPair<int, int>> grid_cells; //(cell, index into grid_geoms), sorted by cell
+    int grid_nx, grid_ny;
+    void gridCollide();
+    void gridTest(int i, int j);
     dJointGroupID contactgroup;
+    dThreadingImplementationID threading;
+    dThreadingThreadPoolID thread_pool;
+    int thread_count;
+    bool auto_disable;
+    QVector<PGeomPair> pairs;
+    ThreadPool *collide_pool;
+    QVector<dContactGeom> pair_contacts; //PWORLD_MAX_CONTACTS slots per pair, filled in parallel
+    QVector<int> pair_contact_count;
+    void collidePairs();
+    unsigned long ode_seed;
     QVector<PObject*> objects;
     QVector<PSurface*> surfaces;
     dReal delta_time;
-    int **sur_matrix;
-    int objects_count;
+    int sur_table[PClassCount * PClassCount]; //surface index per class pair, -1 if they never collide
+    unsigned long collide_bits[PClassCount];
+    QVector<dSpaceID> detached_spaces; //out of space, so its cleanup would not free them
 public:
-    PWorld(dReal dt,dReal gravity,CGraphics* graphics, int robot_count);
+    PWorld(dReal dt,dReal gravity,CGraphics* graphics, int robot_count, const PBroadphase &bp = PBroadphase());
     ~PWorld();
     void setGravity(dReal gravity);
-    void addObject(PObject* o);
+    void addObject(PObject* o, PClass cls);
     void initAllObjects();
-    PSurface* createSurface(PObject* o1,PObject* o2);
+    PSurface* createSurface(PClass c1,PClass c2);
     PSurface* findSurface(PObject* o1,PObject* o2);
+    // recreates every surface of source, callbacks handed source_data get data instead
+    void copySurfaces(const PWorld &source, const void *source_data, void *data);
     void step(dReal dt=-1, bool sync=false);
+    void setSolverIterations(int iterations);
+    void setThreads(int threads);
+    int threadCount() const;
     void glinit();
     void draw();
-    void handleCollisions(dGeomID o1, dGeomID o2);    
+    void setSeed(uint64_t seed);
+    unsigned long getSeed() const;
+    int bodyCount() const;
+    void saveBodies(PBodyState *states) const;
+    void restoreBodies(const PBodyState *states);
+    void addPair(dGeomID o1, dGeomID o2);
+    void handleCollisions(dGeomID o1, dGeomID o2);
+    void addContacts(dGeomID o1, dGeomID o2, const dContactGeom *geoms, int n);
+    void setCollideThreads(int threads);
+    void setAutoDisable(bool enabled);
+    bool autoDisable() const;
+    int sleepingBodyCount() const;
+    void clearContacts();
+    // takes a nested space out of the world space and back, the world still destroys it
+    void detachSpace(dSpaceID s);
+    void attachSpace(dSpaceID s);
+    static void initThread();
     dWorldID world;
     dSpaceID space;
+    PCollisionStats stats{};
     CGraphics* g;
     int robot_count;
 };
@@ -57,11 +156,12 @@ class PSurface
 public:
     PSurface();
     dSurfaceParameters surface{};
-    bool isIt(dGeomID i1,dGeomID i2);
-    dGeomID id1{},id2{};
+    bool isIt(PClass c1,PClass c2);
+    PClass class1{},class2{};
     bool usefdir1;   //if true use fdir1 instead of ODE value
     dVector3 fdir1{};  //fdir1 is a normalized vector tangent to friction force vector
     dVector3 contactPos{},contactNormal{};
     PSurfaceCallback* callback;
+    void* data;     //owner context handed to callback, lets several worlds share one process
 };
 #endif // PWORLD_H
@@ -0,0 +1,89 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Per-phase step timings, kept as log2 histograms of nanoseconds.
+// PROFILE_SCOPE(phase) times the rest of the enclosing block; it compiles to nothing
+// unless the build is configured with -DENABLE_PROFILER=ON.
+
+enum ProfilePhase
+{
+    PROFILE_SIM_STEP,       //whole SSLWorld::simStep
+    PROFILE_BALL_FORCES,    //ball friction before each substep
+    PROFILE_COLLIDE,        //dSpaceCollide and contact creation
+    PROFILE_SOLVE,          //dWorldStep / dWorldQuickStep
+    PROFILE_ROBOTS,         //CRobot::step for every robot
+    PROFILE_RENDER,         //selection and drawing in SSLWorld::step
+    PROFILE_VISION,         //packet fill, serialization and send
+    PROFILE_PHASE_COUNT
+};
+
+#define PROFILER_BUCKETS 48 //bucket i holds durations in [2^(i-1), 2^i) ns
+
+class Profiler
+{
+public:
+    struct Stats
+    {
+        uint64_t count;
+        double mean, p50, p99, max; //microseconds, percentiles are bucket upper bounds
+    };
+    static Profiler &instance();
+    static const char *phaseName(int phase);
+    void add(int phase, int64_t ns);
+    void reset();
+    Stats stats(int phase) const;
+    QString report() const;
+private:
+    Profiler();
+    std::atomic<uint64_t> buckets[PROFILE_PHASE_COUNT][PROFILER_BUCKETS];
+    std::atomic<uint64_t> counts[PROFILE_PHASE_COUNT];
+    std::atomic<int64_t> totals[PROFILE_PHASE_COUNT];
+    std::atomic<int64_t> maxima[PROFILE_PHASE_COUNT];
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(int phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~ProfileScope()
+    {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        Profiler::instance().add(phase, ns.count());
+    }
+private:
+    int phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#ifdef FIRASIM_PROFILER
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+#else
+#define PROFILE_SCOPE(phase)
+#endif
+
+#endif // PROFILER_H
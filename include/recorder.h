@@ -0,0 +1,128 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <QFile>
+#include <QString>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "packet.pb.h"
+
+class SSLWorld;
+
+// Match log: a RecordHeader, the serialized field geometry padded to header_size,
+// then one fixed-size RecordFrame per step. Frames are numbered by the recorder from 0, so
+// frame i sits at header_size + i * record_size whatever the world did to its step count.
+
+#define RECORD_MAGIC "FIRAREC"
+#define RECORD_VERSION 2
+
+struct RecordRobotSettings
+{
+    double radius, height, wheel_radius, wheel1_angle, wheel2_angle;
+    double body_mass, wheel_mass, motor_fmax;
+};
+
+struct RecordHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;       //offset of the first frame
+    uint32_t record_size;       //sizeof(RecordFrame) of the writer
+    uint32_t max_robots;        //robot slots per team in every frame
+    double delta_time;
+    double ball_radius, ball_mass;
+    RecordRobotSettings blue, yellow;
+    uint32_t field_size;        //bytes of fira_message::Field right after this header
+    uint32_t reserved;
+};
+
+struct RecordRobot
+{
+    double x, y, orientation;   //orientation in radians
+    double vx, vy, vorientation;
+    double wheel_left, wheel_right; //as applied this step, in the sign convention of Command
+    uint32_t on;
+    uint32_t reserved;
+};
+
+struct RecordFrame
+{
+    uint32_t frame;             //frames recorded before this one, never repeats or goes back
+    uint32_t step;              //simulation time in ms, as Environment.step
+    int32_t goals_blue, goals_yellow;
+    uint32_t robots_per_team;
+    uint32_t sim_frame;         //world steps, reset at the end of a match and by restoreState
+    double ball[5];             //x, y, z, vx, vy
+    RecordRobot blue[MAX_ROBOT_COUNT];
+    RecordRobot yellow[MAX_ROBOT_COUNT];
+};
+
+// Appends frames from the step loop; a background thread does the file writes in large blocks.
+class MatchRecorder
+{
+public:
+    MatchRecorder();
+    ~MatchRecorder();
+    bool open(const QString &fileName, SSLWorld *world);
+    void close();
+    bool isOpen() const;
+    // frames have MAX_ROBOT_COUNT slots per team, larger teams are refused with an error
+    static bool supports(int robots_per_team);
+    // copies the frame, numbers it and returns at once, called with the world locked
+    void record(const RecordFrame &frame);
+private:
+    void writer();
+    QFile file;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<RecordFrame> pending, writing;
+    uint32_t next_frame;
+    bool stopping;
+};
+
+// Read side: maps the whole log, so any frame is a pointer away.
+class MatchLog
+{
+public:
+    MatchLog();
+    ~MatchLog();
+    bool open(const QString &fileName);
+    void close();
+    const RecordHeader *header() const;
+    bool field(fira_message::Field *field) const;
+    qint64 frameCount() const;
+    const RecordFrame *frameAt(qint64 index) const;
+    // offset in the file of the record of a frame number, -1 if it is not in the log
+    qint64 offset(uint32_t frame) const;
+    const RecordFrame *findFrame(uint32_t frame) const;
+private:
+    QFile file;
+    const uchar *data;
+    qint64 size;
+};
+
+#endif // RECORDER_H
@@ -0,0 +1,66 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QByteArray>
+
+#include "recorder.h"
+#include "net/robocup_ssl_server.h"
+
+// Streams a recorded match (see MatchRecorder) to the vision port without running physics.
+// Speed 1 is real time, 4 four times faster, 0 as fast as the socket takes it.
+class ReplayStreamer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReplayStreamer(RoboCupSSLServer *server, QObject *parent = nullptr);
+    bool open(const QString &fileName);
+    void setSpeed(double speed);
+    void setLoop(bool loop);
+    void setGeometryEvery(int frames);
+    // moves to a recorded frame number, false if it is not in the log
+    bool seek(uint32_t frame);
+    void start();
+    void stop();
+    qint64 position() const;
+signals:
+    void finished();
+private slots:
+    void tick();
+private:
+    void restartClock();
+    void sendFrame(const RecordFrame &f);
+    MatchLog log;
+    RoboCupSSLServer *server;
+    QTimer timer;
+    QElapsedTimer clock;
+    qint64 index, clock_index, sent;
+    double speed;
+    bool loop;
+    int geometry_every;
+    fira_message::Field field;
+    fira_message::sim_to_ref::Environment packet;
+    QByteArray buffer;
+};
+
+#endif // REPLAY_H
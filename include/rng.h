@@ -0,0 +1,40 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+// xoshiro256** generator owned by one world, so a seed fully determines its noise
+// and random placements regardless of what other worlds or threads draw.
+class Rng
+{
+public:
+    explicit Rng(uint64_t seed = 0);
+    void seed(uint64_t seed);
+    uint64_t next();
+    double uniform();                           //[0, 1)
+    double uniform(double lo, double hi);
+    double normal(double mu = 0.0, double sigma = 1.0);
+    uint64_t s[4];
+    bool deviateAvailable;
+    double storedDeviate;
+};
+
+#endif // RNG_H
@@ -44,9 +44,12 @@ class CRobot
     int m_rob_id;
     bool firsttime;
     bool last_state{};
+    bool attached; //bodies and joints simulated, geoms in the world space
+    void setBodiesEnabled(bool enabled);
 
 public:
     ConfigWidget *cfg;
+    RobotSettings settings; //copied from the world, cfg is shared between worlds
     dSpaceID space;
     PObject *chassis;
     PBox *boxes[3]{};
@@ -80,7 +83,15 @@ public:
         CRobot *rob;
     } * balls[2]{};
 
-    CRobot(PWorld *world, PBall *ball, ConfigWidget *_cfg, dReal x, dReal y, dReal z,
+    //everything step() carries over between steps, besides the ODE bodies
+    struct State
+    {
+        dReal speed[2];
+        dReal motor_vel[2];
+        bool on, last_state, firsttime;
+    };
+
+    CRobot(PWorld *world, PBall *ball, ConfigWidget *_cfg, const RobotSettings &_settings, dReal x, dReal y, dReal z,
            dReal r, dReal g, dReal b, int rob_id, int wheeltexid, int dir, bool turn_on);
     ~CRobot();
     void step();
@@ -90,6 +101,8 @@ public:
     dReal getSpeed(int i);
     void incSpeed(int i, dReal v);
     void resetSpeeds();
+    void wake();
+    void setOn(bool turn_on);
     void resetRobot();
     void getXY(dReal &x, dReal &y);
     dReal getDir();
@@ -99,8 +112,10 @@ public:
     int getID();
     PBall *getBall();
     PWorld *getWorld();
+    void saveState(State &s) const;
+    void restoreState(const State &s);
 };
 
-#define ROBOT_START_Z(cfg) ((cfg)->robotSettings.RobotHeight * 0.5 + (cfg)->robotSettings.BottomHeight)
+#define ROBOT_START_Z(settings) ((settings).RobotHeight * 0.5 + (settings).BottomHeight)
 
 #endif // ROBOT_H
@@ -33,6 +33,7 @@ class RobotWidget : public QDockWidget
 public:    
     RobotWidget(QWidget* parent, ConfigWidget* cfg);
     void setPicture(QImage* img);
+    void setRobotCount(int count);
     QComboBox *teamCombo,*robotCombo;
     QLabel *robotpic;
     QLabel *vellabel,*acclabel;
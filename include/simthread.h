@@ -0,0 +1,51 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIMTHREAD_H
+#define SIMTHREAD_H
+
+#include <QThread>
+#include <atomic>
+
+class SSLWorld;
+class ConfigWidget;
+
+// Steps an SSLWorld back to back on its own thread, independent of any timer.
+// RealTimeFactor() caps the pace (0 runs as fast as possible); while a lock-step
+// client drives the world the thread idles. Vision datagrams are queued back to
+// the world's own thread, which owns the sockets.
+class SimThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit SimThread(ConfigWidget* _cfg, QObject *parent = nullptr);
+    ~SimThread() override;
+    void setWorld(SSLWorld *w);
+    void startStepping();
+    void stopStepping();
+    double stepRate() const;
+protected:
+    void run() override;
+private:
+    ConfigWidget* cfg;
+    SSLWorld* world;
+    std::atomic<bool> stopping;
+    std::atomic<double> rate;
+};
+
+#endif // SIMTHREAD_H
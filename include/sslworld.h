@@ -20,10 +20,16 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #define SSLWORLD_H
 
 
-#include <QGLWidget>
 #include <QObject>
 #include <QUdpSocket>
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 
 #include "graphics.h"
@@ -34,20 +40,41 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #include "physics/pray.h"
 
 #include "net/robocup_ssl_server.h"
+#include "net/shm_channel.h"
+#include "recorder.h"
 
 #include "robot.h"
 #include "configwidget.h"
 
 #include "config.h"
+#include "rng.h"
 #include "speed_estimator.h"
 #define WALL_COUNT 16
 
 class RobotsFormation;
+
+// what a world is built from, read from the config once and shared read-only with clones
+struct SSLWorldLayout
+{
+    struct Box
+    {
+        double x, y, z, w, h, l;
+        double r, g, b;
+        double angle; //around z
+    };
+    int robot_count;
+    RobotSettings robot_settings;
+    dReal ball_radius, ball_mass;
+    dReal field_rad, field_length, field_width;
+    dReal penalty_depth, penalty_width, penalty_point, line_width;
+    PBroadphase broadphase;
+    Box walls[WALL_COUNT];
+};
+
 class SendingPacket {
     public:
-    SendingPacket(fira_message::sim_to_ref::Environment* _packet,int _t);
-    fira_message::sim_to_ref::Environment* packet;
-    int t;
+    QByteArray data; //serialized Environment, keeps its capacity between frames
+    int t = 0;
 };
 
 class SSLWorld : public QObject
@@ -55,15 +82,33 @@ class SSLWorld : public QObject
     Q_OBJECT
 private:
     QGLWidget* m_parent;
+    RobotsFormation* formation;
     int frame_num;
     dReal last_dt;
-    QList<SendingPacket*> sendQueue;
+    QVector<SendingPacket> sendQueue; //ring of delayed frames, only grows when sendDelay does
+    int send_head = 0, send_count = 0;
+    fira_message::sim_to_ref::Environment vision_packet;
+    fira_message::Field field_geometry;
+    QByteArray field_bytes; //field_geometry serialized as Environment.field
+    bool geometry_pending = true;
+    RecordFrame record_frame{};
     char *in_buffer;
-    bool lastInfraredState[TEAM_COUNT][MAX_ROBOT_COUNT]{};
+    std::vector<char> lastInfraredState; //indexed like robots
     int steps_super, steps_fault;
-    KickStatus lastKickState[TEAM_COUNT][MAX_ROBOT_COUNT]{};
+    std::vector<KickStatus> lastKickState;
+
+    std::shared_ptr<const SSLWorldLayout> layout;
 
+    explicit SSLWorld(const SSLWorld *source);
+    void build(const std::vector<dReal> &x, const std::vector<dReal> &y);
+    void writeState(QByteArray &state);
     void getValidPosition(dReal &x, dReal &y, uint32_t max);
+    void placeRobots(const dReal *posX, const dReal *posY, dReal sx);
+    void growSendQueue();
+    void recordCommands();
+    void recordFrame();
+    bool geometryDue();
+    void endFrame();
 
 public:    
     dReal customDT;
@@ -73,23 +118,39 @@ public:
     SSLWorld(QGLWidget* parent, ConfigWidget* _cfg, RobotsFormation *form);
     ~SSLWorld() override;
     void glinit();
+    void setSeed(int seed);
     void simStep(dReal dt=-1);
+    int substepCount();
     void step(dReal dt=-1);
+    void advance(dReal dt=-1);
     void posProcess();
     fira_message::sim_to_ref::Environment* generatePacket();
+    void fillPacket(fira_message::sim_to_ref::Environment *env);
+    void updateFieldGeometry();
+    void requestGeometry();
+    const fira_message::Field &fieldGeometry() const;
     void sendVisionBuffer();
+    void processPacket(const fira_message::sim_to_ref::Packet &packet);
+    void recvSharedActions();
+    void simulate(const fira_message::sim_to_ref::Packet &packet, fira_message::sim_to_ref::Environment *env);
+    // snapshot of everything that affects later steps, restorable into a world with the same config
+    void saveState(QByteArray &state);
+    bool restoreState(const QByteArray &state);
+    // independent copy without graphics or sockets, to be stepped on any thread
+    SSLWorld* clone();
     int  robotIndex(unsigned int robot, int team);
     const dReal* ball_vel;
     const dReal* robot_vel;
     const dReal* robot_angular_vel;
 
-    ConfigWidget* cfg;
+    ConfigWidget* cfg; //shared between worlds, only read
+    RobotSettings robotSettings; //what every robot of this world is built with
     CGraphics* g;
     PWorld* p;
     PBall* ball;
     speedEstimator* ball_speed_estimator;
-    speedEstimator* blue_speed_estimator [MAX_ROBOT_COUNT];
-    speedEstimator* yellow_speed_estimator [MAX_ROBOT_COUNT];
+    std::vector<speedEstimator*> blue_speed_estimator;
+    std::vector<speedEstimator*> yellow_speed_estimator;
     PGround* ground;
     PRay* ray;
     PFixedBox* walls[WALL_COUNT]{};
@@ -98,31 +159,42 @@ public:
     dReal cursor_x{},cursor_y{},cursor_z{};
     dReal cursor_radius{};
     RoboCupSSLServer *visionServer{};
+    ShmChannel *shmChannel{}; //same-host state/command channel, published without sendDelay
+    MatchRecorder *recorder{}; //every step is appended to it when set
     QUdpSocket *commandSocket{};
     bool updatedCursor;
     bool withGoalKick = false;
     bool randomStart = false;
-    CRobot* robots[MAX_ROBOT_COUNT*2]{};
+    std::vector<CRobot*> robots; //blue 0..n-1 then yellow, n = Robots_Count
     QElapsedTimer *timer, *timer_fault;
     bool received = true;
+    std::atomic<bool> lockStep{false}; //stepped only by simulate(), step() just renders
+    bool freeRunning = false; //stepped by a SimThread through advance(), step() just renders
+    QMutex mutex; //held while the world is stepped or rendered
     bool fullSpeed = false;
+    Rng rng; //noise, vanishing and random placement, seeded from Seed
     int minute = 0;
     dReal last_speed = 0.0;
     std::pair<float, float> ball_prev_pos = std::pair<float, float>(0.0, 0.0);
 public slots:
     void recvActions();
+    void sendDatagram(const QByteArray &datagram);
 signals:
     void fpsChanged(int newFPS);
+    void visionDatagram(const QByteArray &datagram); //queued to our thread by sendVisionBuffer
 };
 
 class RobotsFormation {
     public:
-        dReal x[MAX_ROBOT_COUNT]{};
-        dReal y[MAX_ROBOT_COUNT]{};
+        std::vector<dReal> x;
+        std::vector<dReal> y;
         RobotsFormation(int type, ConfigWidget* _cfg);
-        void setAll(const dReal *xx,const dReal *yy);
+        void setAll(const dReal *xx,const dReal *yy,int count);
+        // grows x and y to 2 * Robots_Count, placing robots past the preset tables on spots
+        // that stay free in both the blue and the mirrored yellow layout
+        void fit();
         void loadFromFile(const QString& filename);
-        void resetRobots(CRobot** r,int team);
+        void resetRobots(const std::vector<CRobot*>& r,int team);
     private:
         ConfigWidget* cfg;
 };
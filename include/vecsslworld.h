@@ -0,0 +1,52 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VECSSLWORLD_H
+#define VECSSLWORLD_H
+
+#include <vector>
+
+#include "sslworld.h"
+#include "threadpool.h"
+
+#define VEC_BALL_OBS_SIZE 5   //x, y, z, vx, vy
+#define VEC_ROBOT_OBS_SIZE 7  //x, y, orientation, vx, vy, vorientation, on
+
+// K independent matches stepped in one call, without network or protobuf.
+// Actions are packed per world as [blue 0..n-1, yellow 0..n-1] x [wheel_left, wheel_right],
+// observations per world as ball followed by every robot in the same order.
+class VecSSLWorld
+{
+public:
+    VecSSLWorld(int count, ConfigWidget* _cfg, RobotsFormation *form, int threads = 1);
+    ~VecSSLWorld();
+    int count() const;
+    int actionSize() const;
+    int observationSize() const;
+    void step(const double *actions, float *observations);
+    void observe(float *observations);
+    SSLWorld* world(int i);
+private:
+    void applyActions(SSLWorld *w, const double *actions);
+    void observeWorld(SSLWorld *w, float *obs);
+    ConfigWidget* cfg;
+    std::vector<SSLWorld*> worlds;
+    ThreadPool pool;
+};
+
+#endif // VECSSLWORLD_H
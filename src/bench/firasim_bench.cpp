@@ -0,0 +1,386 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#ifdef HAVE_UNIX
+#include <unistd.h>
+#endif
+
+#include "sslworld.h"
+
+// firasim_bench: steps a world with scripted wheel commands, no GUI or network,
+// and prints one JSON object per scenario on stdout.
+//
+//   firasim_bench [--config FILE] [--5v5] [--formation FILE|DIR | --preset N]
+//                 [--scenario idle|full|scrum|wall|cluster|all] [--steps N] [--warmup N]
+//                 [--broadphase hash|sap|quadtree|grid|all] [--robots 1,3,5 | --scaling]
+//                 [--ode-threads 1,2,4] [--collide-threads 1,2,4] [--error-budget]
+//
+// --robots is per team, --scaling is short for --robots 1,2,4,8,16,32.
+// --formation DIR runs every *.formation file in DIR. --error-budget replaces the
+// timing runs with the trajectory deviation of each physics profile from accurate.
+
+#define BENCH_FULL_SPEED 50.0 //wheel speed of the moving scenarios, rad/s
+#define BENCH_TURN_GAIN 20.0  //wheel speed difference per radian of heading error
+
+static const char *scenarios[] = {"idle", "full", "scrum", "wall", "cluster"};
+static const char *broadphases[] = {"hash", "sap", "quadtree", "grid"};
+static const char *scaling_robots = "1,2,4,8,16,32";
+static const char *budget_profiles[] = {"training", "ultra-fast"};
+
+static char *argValue(char **argv, char **argend, const char *name)
+{
+    char **arg = std::find(argv, argend, std::string(name));
+    return (arg != argend && arg + 1 != argend) ? *(arg + 1) : nullptr;
+}
+
+static double wrapAngle(double a)
+{
+    while (a > M_PI)
+        a -= 2 * M_PI;
+    while (a < -M_PI)
+        a += 2 * M_PI;
+    return a;
+}
+
+//differential drive towards (tx, ty) at full speed
+static void driveTo(CRobot *r, double tx, double ty)
+{
+    dReal x, y;
+    r->getXY(x, y);
+    const double heading = r->getDir() * M_PI / 180.0;
+    const double error = wrapAngle(atan2(ty - y, tx - x) - heading);
+    const double turn = BENCH_TURN_GAIN * error;
+    r->setSpeed(0, -1 * (BENCH_FULL_SPEED - turn));
+    r->setSpeed(1, BENCH_FULL_SPEED + turn);
+}
+
+static void command(SSLWorld &world, ConfigWidget &cfg, const char *scenario)
+{
+    dReal bx, by, bz;
+    world.ball->getBodyPosition(bx, by, bz);
+    for (int k = 0; k < cfg.Robots_Count() * 2; k++)
+    {
+        CRobot *r = world.robots[k];
+        if (strcmp(scenario, "full") == 0)
+        {
+            r->setSpeed(0, -BENCH_FULL_SPEED);
+            r->setSpeed(1, BENCH_FULL_SPEED);
+        }
+        else if (strcmp(scenario, "scrum") == 0 || strcmp(scenario, "cluster") == 0)
+            driveTo(r, bx, by);
+        else if (strcmp(scenario, "wall") == 0)
+        {
+            //push into the nearest side wall while sliding along it
+            dReal x, y;
+            r->getXY(x, y);
+            driveTo(r, x + 0.2, y < 0 ? -cfg.Field_Width() : cfg.Field_Width());
+        }
+        else
+        {
+            r->setSpeed(0, 0);
+            r->setSpeed(1, 0);
+        }
+    }
+}
+
+//every robot packed on a ring around the ball at the centre, so most pairs touch
+static void cluster(SSLWorld &world, ConfigWidget &cfg)
+{
+    const int n = cfg.Robots_Count() * 2;
+    const double radius = world.robotSettings.RobotRadius;
+    const double ring = std::max(radius * 2.5, n * radius * 2.1 / (2 * M_PI));
+    world.ball->setBodyPosition(0, 0, cfg.BallRadius());
+    for (int k = 0; k < n; k++)
+        world.robots[k]->setXY(ring * cos(2 * M_PI * k / n), ring * sin(2 * M_PI * k / n));
+}
+
+static QList<int> countList(const char *arg, int fallback)
+{
+    QList<int> counts;
+    for (const QString &t : QString(arg).split(',', QString::SkipEmptyParts))
+        counts.append(qMax(1, t.toInt()));
+    if (counts.isEmpty())
+        counts.append(fallback);
+    return counts;
+}
+
+//resident set size right now; ru_maxrss would only ever report the largest world so far
+static long currentRssKb()
+{
+#ifdef HAVE_LINUX
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == nullptr)
+        return 0;
+    long size = 0, resident = 0;
+    const int read = fscanf(f, "%ld %ld", &size, &resident);
+    fclose(f);
+    return read == 2 ? resident * (sysconf(_SC_PAGESIZE) / 1024) : 0;
+#else
+    return 0;
+#endif
+}
+
+//a formation file, or every *.formation file of a directory
+static QStringList formationList(const char *arg)
+{
+    QStringList files;
+    if (arg == nullptr)
+        return files;
+    const QFileInfo info(arg);
+    if (!info.isDir())
+        return QStringList(QString(arg));
+    const QDir dir(info.filePath());
+    for (const QString &name : dir.entryList(QStringList("*.formation"), QDir::Files, QDir::Name))
+        files.append(dir.filePath(name));
+    return files;
+}
+
+//runs one scenario on a fresh world built from the current config
+static QJsonObject run(ConfigWidget &cfg, int preset, const QString &formation_file, const char *s, int steps, int warmup)
+{
+    RobotsFormation form(preset, &cfg);
+    if (!formation_file.isEmpty())
+        form.loadFromFile(formation_file);
+    const long rss_before = currentRssKb();
+    SSLWorld world(nullptr, &cfg, &form);
+    const long rss_built = currentRssKb();
+    if (strcmp(s, "cluster") == 0)
+        cluster(world, cfg);
+
+    for (int i = 0; i < warmup; i++)
+    {
+        command(world, cfg, s);
+        world.simStep(cfg.DeltaTime());
+    }
+    world.p->stats = PCollisionStats();
+    QElapsedTimer timer;
+    qint64 sleeping = 0;
+    timer.start();
+    for (int i = 0; i < steps; i++)
+    {
+        command(world, cfg, s);
+        world.simStep(cfg.DeltaTime());
+        sleeping += world.p->sleepingBodyCount();
+    }
+    const qint64 ns = timer.nsecsElapsed();
+    const PCollisionStats &stats = world.p->stats;
+
+    QJsonObject result;
+    result["scenario"] = s;
+    result["division"] = QString::fromStdString(cfg.Division());
+    result["robots"] = cfg.Robots_Count() * 2;
+    result["formation"] = !formation_file.isEmpty() ? formation_file : QString("preset %1").arg(preset);
+    result["physics_profile"] = QString::fromStdString(cfg.PhysicsProfile());
+    result["substeps"] = cfg.Substeps();
+    result["broadphase"] = QString::fromStdString(cfg.Broadphase());
+    //what the world got, not what was asked for: ODE without threading stays at 1
+    result["ode_threads"] = world.p->threadCount();
+    result["collide_threads"] = cfg.CollideThreads();
+    result["auto_disable"] = cfg.AutoDisable();
+    result["bodies"] = world.p->bodyCount();
+    result["sleeping_bodies_mean"] = static_cast<double>(sleeping) / steps;
+    result["steps"] = steps;
+    result["seconds"] = ns / 1e9;
+    result["steps_per_second"] = steps / (ns / 1e9);
+    result["ns_per_step"] = static_cast<double>(ns) / steps;
+    result["ns_per_robot_step"] = static_cast<double>(ns) / steps / (cfg.Robots_Count() * 2);
+    //memory the world took when it was built and what the process holds after the run
+    result["world_rss_kb"] = static_cast<double>(rss_built - rss_before);
+    result["rss_kb"] = static_cast<double>(currentRssKb());
+    //per step, summed over substeps; aabb tests are only counted by the grid
+    result["aabb_tests_per_step"] = static_cast<double>(stats.aabb_tests) / steps;
+    result["candidate_pairs_per_step"] = static_cast<double>(stats.candidate_pairs) / steps;
+    result["surface_pairs_per_step"] = static_cast<double>(stats.surface_pairs) / steps;
+    result["contact_pairs_per_step"] = static_cast<double>(stats.contact_pairs) / steps;
+    return result;
+}
+
+//ball then robot positions after every step of one scenario under the current profile
+static std::vector<double> trajectory(ConfigWidget &cfg, int preset, const QString &formation_file, const char *s, int steps)
+{
+    RobotsFormation form(preset, &cfg);
+    if (!formation_file.isEmpty())
+        form.loadFromFile(formation_file);
+    SSLWorld world(nullptr, &cfg, &form);
+    if (strcmp(s, "cluster") == 0)
+        cluster(world, cfg);
+    const int n = cfg.Robots_Count() * 2;
+    std::vector<double> points;
+    points.reserve(static_cast<size_t>(steps) * (n + 1) * 2);
+    for (int i = 0; i < steps; i++)
+    {
+        command(world, cfg, s);
+        world.simStep(cfg.DeltaTime());
+        dReal x, y, z;
+        world.ball->getBodyPosition(x, y, z);
+        points.push_back(x);
+        points.push_back(y);
+        for (int k = 0; k < n; k++)
+        {
+            world.robots[k]->getXY(x, y);
+            points.push_back(x);
+            points.push_back(y);
+        }
+    }
+    return points;
+}
+
+//deviation of every profile from accurate on the same seed and command stream
+static QJsonArray errorBudget(ConfigWidget &cfg, int preset, const QString &formation_file, const char *s, int steps)
+{
+    cfg.v_PhysicsProfile = "accurate";
+    cfg.applyPhysicsProfile();
+    const std::vector<double> reference = trajectory(cfg, preset, formation_file, s, steps);
+    const size_t stride = (cfg.Robots_Count() * 2 + 1) * 2;
+    QJsonArray results;
+    for (const char *profile : budget_profiles)
+    {
+        cfg.v_PhysicsProfile = profile;
+        cfg.applyPhysicsProfile();
+        const std::vector<double> points = trajectory(cfg, preset, formation_file, s, steps);
+        double ball_max = 0, ball_sum = 0, robot_max = 0, robot_sum = 0;
+        for (size_t i = 0; i < points.size(); i += 2)
+        {
+            const double d = std::hypot(points[i] - reference[i], points[i + 1] - reference[i + 1]);
+            if (i % stride == 0)
+            {
+                ball_max = std::max(ball_max, d);
+                ball_sum += d * d;
+            }
+            else
+            {
+                robot_max = std::max(robot_max, d);
+                robot_sum += d * d;
+            }
+        }
+        const double samples = static_cast<double>(steps);
+        const double robot_samples = samples * (stride / 2 - 1);
+        const size_t last = points.size() - stride;
+        QJsonObject result;
+        result["scenario"] = s;
+        result["division"] = QString::fromStdString(cfg.Division());
+        result["robots"] = cfg.Robots_Count() * 2;
+        result["formation"] = !formation_file.isEmpty() ? formation_file : QString("preset %1").arg(preset);
+        result["physics_profile"] = profile;
+        result["reference_profile"] = "accurate";
+        result["steps"] = steps;
+        result["ball_max_m"] = ball_max;
+        result["ball_rms_m"] = std::sqrt(ball_sum / samples);
+        result["ball_final_m"] = std::hypot(points[last] - reference[last], points[last + 1] - reference[last + 1]);
+        result["robot_max_m"] = robot_max;
+        result["robot_rms_m"] = std::sqrt(robot_sum / robot_samples);
+        results.append(result);
+    }
+    return results;
+}
+
+int main(int argc, char *argv[])
+{
+    char** argend = argc + argv;
+    QCoreApplication a(argc, argv);
+
+    const bool forceDivisionA = std::find(argv, argend, std::string("--5v5")) != argend;
+    const char *config_file = argValue(argv, argend, "--config");
+    ConfigWidget cfg(forceDivisionA, config_file ? QString(config_file) : QString());
+    //the same seed every run, so numbers only move when the code does
+    if (cfg.Seed() == 0)
+        cfg.set_Seed(1);
+
+    const char *scenario = argValue(argv, argend, "--scenario");
+    const char *steps_arg = argValue(argv, argend, "--steps");
+    const char *warmup_arg = argValue(argv, argend, "--warmup");
+    const char *preset_arg = argValue(argv, argend, "--preset");
+    const char *formation_arg = argValue(argv, argend, "--formation");
+    const char *broadphase = argValue(argv, argend, "--broadphase");
+    const bool scaling = std::find(argv, argend, std::string("--scaling")) != argend;
+    const bool error_budget = std::find(argv, argend, std::string("--error-budget")) != argend;
+    const char *robots_arg = scaling ? scaling_robots : argValue(argv, argend, "--robots");
+    const char *threads_arg = argValue(argv, argend, "--ode-threads");
+    const char *collide_arg = argValue(argv, argend, "--collide-threads");
+    const int steps = steps_arg ? std::max(1, atoi(steps_arg)) : 2000;
+    const int warmup = warmup_arg ? atoi(warmup_arg) : 100;
+    const int preset = preset_arg ? atoi(preset_arg) : (cfg.Division() == "Division A" ? 3 : 4);
+
+    const QList<int> robot_counts = countList(robots_arg, cfg.Robots_Count());
+    const QList<int> thread_counts = countList(threads_arg, cfg.ODEThreads());
+    const QList<int> collide_counts = countList(collide_arg, cfg.CollideThreads());
+
+    const std::string config_broadphase = cfg.Broadphase();
+    QStringList formation_files = formationList(formation_arg);
+    if (formation_arg != nullptr && formation_files.isEmpty())
+    {
+        std::cerr << "No formation files in " << formation_arg << std::endl;
+        return 1;
+    }
+    if (formation_files.isEmpty())
+        formation_files.append(QString()); //the preset
+
+    QJsonArray results;
+    for (const char *b : broadphases)
+    {
+        if (broadphase == nullptr ? config_broadphase != b : strcmp(broadphase, "all") != 0 && strcmp(broadphase, b) != 0)
+            continue;
+        cfg.v_Broadphase = b;
+        for (const char *s : scenarios)
+        {
+            if (scenario != nullptr && strcmp(scenario, "all") != 0 && strcmp(scenario, s) != 0)
+                continue;
+            for (const QString &formation_file : formation_files)
+                for (int robots : robot_counts)
+                {
+                    cfg.set_Robots_Count(robots);
+                    if (error_budget)
+                    {
+                        for (const QJsonValue &result : errorBudget(cfg, preset, formation_file, s, steps))
+                            results.append(result);
+                        continue;
+                    }
+                    //speedup is against the first thread counts of both lists
+                    double baseline = 0;
+                    for (int threads : thread_counts)
+                        for (int collide : collide_counts)
+                        {
+                            cfg.set_ODEThreads(threads);
+                            cfg.set_CollideThreads(collide);
+                            QJsonObject result = run(cfg, preset, formation_file, s, steps, warmup);
+                            if (baseline == 0)
+                                baseline = result["steps_per_second"].toDouble();
+                            result["speedup"] = result["steps_per_second"].toDouble() / baseline;
+                            results.append(result);
+                        }
+                }
+        }
+    }
+    std::cout << QJsonDocument(results).toJson().toStdString();
+    return results.isEmpty() ? 1 : 0;
+}
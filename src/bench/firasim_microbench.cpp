@@ -0,0 +1,196 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "sslworld.h"
+#include "speed_estimator.h"
+#include "net/robocup_ssl_server.h"
+
+// firasim_microbench: times single hot functions on fixed inputs.
+// Every case runs BENCH_SAMPLES samples of a calibrated iteration count and reports
+// the median, the median absolute deviation and the minimum, in ns per call.
+//
+//   firasim_microbench [--config FILE] [--5v5] [--filter SUBSTRING]
+
+#define BENCH_SAMPLES 31
+#define BENCH_SAMPLE_NS 5000000 //each sample runs at least this long
+
+bool wheelCallBack(dGeomID o1, dGeomID o2, PSurface *s, int robots_count);
+bool ballCallBack(dGeomID o1, dGeomID o2, PSurface *s, int robots_count);
+
+using namespace fira_message::sim_to_ref;
+
+static volatile int sink; //keeps results alive so calls are not optimised out
+
+template <typename F>
+static qint64 timeRun(F &f, qint64 iterations)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 i = 0; i < iterations; i++)
+        f();
+    return timer.nsecsElapsed();
+}
+
+static double median(std::vector<double> v)
+{
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+template <typename F>
+static void measure(QJsonArray &results, const char *filter, const char *name, F f, const std::function<void()> &after = nullptr)
+{
+    if (filter != nullptr && strstr(name, filter) == nullptr)
+        return;
+    qint64 iterations = 1;
+    while (timeRun(f, iterations) < BENCH_SAMPLE_NS)
+    {
+        if (after)
+            after();
+        iterations *= 2;
+    }
+    if (after)
+        after();
+    std::vector<double> samples;
+    for (int s = 0; s < BENCH_SAMPLES; s++)
+    {
+        samples.push_back(static_cast<double>(timeRun(f, iterations)) / iterations);
+        if (after)
+            after();
+    }
+    const double med = median(samples);
+    std::vector<double> deviations;
+    for (double x : samples)
+        deviations.push_back(fabs(x - med));
+    QJsonObject result;
+    result["name"] = name;
+    result["iterations"] = static_cast<double>(iterations);
+    result["samples"] = BENCH_SAMPLES;
+    result["median_ns"] = med;
+    result["mad_ns"] = median(deviations);
+    result["min_ns"] = *std::min_element(samples.begin(), samples.end());
+    results.append(result);
+}
+
+int main(int argc, char *argv[])
+{
+    char** argend = argc + argv;
+    QCoreApplication a(argc, argv);
+
+    const bool forceDivisionA = std::find(argv, argend, std::string("--5v5")) != argend;
+    char** config_arg = std::find(argv, argend, std::string("--config"));
+    char** filter_arg = std::find(argv, argend, std::string("--filter"));
+    const char *filter = (filter_arg != argend && filter_arg + 1 != argend) ? *(filter_arg + 1) : nullptr;
+    ConfigWidget cfg(forceDivisionA, (config_arg != argend && config_arg + 1 != argend) ? QString(*(config_arg + 1)) : QString());
+    cfg.set_Seed(1);
+    RobotsFormation form(cfg.Division() == "Division A" ? 3 : 4, &cfg);
+    SSLWorld world(nullptr, &cfg, &form);
+
+    //fixed scene: let everything settle on the ground, then put robot 1 against
+    //robot 0 and the ball against robot 2
+    for (int i = 0; i < 60; i++)
+        world.simStep(cfg.DeltaTime());
+    dReal x, y;
+    world.robots[0]->getXY(x, y);
+    world.robots[1]->setXY(x + world.robotSettings.RobotRadius * 1.9, y);
+    world.robots[2]->getXY(x, y);
+    world.ball->setBodyPosition(x + world.robotSettings.RobotRadius + cfg.BallRadius() * 0.9, y, cfg.BallRadius());
+
+    PWorld *p = world.p;
+    CRobot *r0 = world.robots[0];
+    CRobot *r1 = world.robots[1];
+    CRobot *r2 = world.robots[2];
+    const auto clear = [p]() { p->clearContacts(); };
+
+    QJsonArray results;
+    measure(results, filter, "handleCollisions ball-ground",
+            [&]() { p->handleCollisions(world.ball->geom, world.ground->geom); }, clear);
+    measure(results, filter, "handleCollisions wheel-ground",
+            [&]() { p->handleCollisions(r0->wheels[0]->cyl->geom, world.ground->geom); }, clear);
+    measure(results, filter, "handleCollisions robot-robot",
+            [&]() { p->handleCollisions(r0->chassis->geom, r1->chassis->geom); }, clear);
+    measure(results, filter, "handleCollisions ball-robot",
+            [&]() { p->handleCollisions(world.ball->geom, r2->chassis->geom); }, clear);
+    measure(results, filter, "handleCollisions ball-wall (no contact)",
+            [&]() { p->handleCollisions(world.ball->geom, world.walls[0]->geom); }, clear);
+
+    PSurface *wheel_ground = p->findSurface(r0->wheels[0]->cyl, world.ground);
+    PSurface *ball_ground = p->findSurface(world.ball, world.ground);
+    measure(results, filter, "wheelCallBack",
+            [&]() { sink = wheelCallBack(r0->wheels[0]->cyl->geom, world.ground->geom, wheel_ground, cfg.Robots_Count()); });
+    measure(results, filter, "ballCallBack",
+            [&]() { sink = ballCallBack(world.ball->geom, world.ground->geom, ball_ground, cfg.Robots_Count()); });
+
+    Environment env;
+    measure(results, filter, "SSLWorld::fillPacket (reused)", [&]() { world.fillPacket(&env); });
+    measure(results, filter, "SSLWorld::generatePacket",
+            [&]() { Environment *e = world.generatePacket(); sink = e->step(); delete e; });
+
+    world.fillPacket(&env);
+    QByteArray buffer;
+    measure(results, filter, "Environment serialize (send path)", [&]() {
+        buffer.resize(env.ByteSize());
+        env.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8 *>(buffer.data()));
+    });
+    RoboCupSSLServer server;
+    server.change_address("127.0.0.1");
+    server.change_port(10999);
+    measure(results, filter, "RoboCupSSLServer::send loopback", [&]() { sink = server.send(env); });
+
+    Packet packet;
+    for (int k = 0; k < cfg.Robots_Count() * 2; k++)
+    {
+        auto *command = packet.mutable_cmd()->add_robot_commands();
+        command->set_id(k % cfg.Robots_Count());
+        command->set_yellowteam(k >= cfg.Robots_Count());
+        command->set_wheel_left(10 + k);
+        command->set_wheel_right(10 - k);
+    }
+    const std::string datagram = packet.SerializeAsString();
+    Packet parsed;
+    measure(results, filter, "Packet parse (recvActions path)",
+            [&]() { sink = parsed.ParseFromArray(datagram.data(), static_cast<int>(datagram.size())); });
+    measure(results, filter, "SSLWorld::processPacket", [&]() { world.processPacket(parsed); });
+
+    speedEstimator estimator(true, 0.95, 100000);
+    dReal pose[3] = {0, 0, 0}, vel[3];
+    double t = 0;
+    measure(results, filter, "speedEstimator::estimateSpeed", [&]() {
+        //a robot on a fixed circle, 16 ms apart
+        t += 16;
+        pose[0] = cos(t / 1000.0);
+        pose[1] = sin(t / 1000.0);
+        pose[2] = t / 1000.0 + M_PI / 2;
+        estimator.estimateSpeed(t, pose, vel);
+    });
+
+    std::cout << QJsonDocument(results).toJson().toStdString();
+    return 0;
+}
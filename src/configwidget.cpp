@@ -18,8 +18,31 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 
 #include "configwidget.h"
 
+#include <QCoreApplication>
+#include <QDir>
 #include <memory>
 
+#ifdef FIRASIM_HEADLESS
+
+static int readInt(QSettings& s, const char* key, int d) {return s.value(key, d).toInt();}
+static double readDouble(QSettings& s, const char* key, double d) {return s.value(key, d).toDouble();}
+static bool readBool(QSettings& s, const char* key, bool d) {return s.value(key, d).toBool();}
+static std::string readString(QSettings& s, const char* key, const std::string& d)
+{
+    return s.value(key, QString::fromStdString(d)).toString().toStdString();
+}
+static std::string readStringEnum(QSettings& s, const char* key, const std::string& d) {return readString(s, key, d);}
+
+#define ADD_ENUM(type,name,Defaultvalue,namestring) \
+    v_##name = read##type(settings, #name, Defaultvalue);
+#define ADD_VALUE(parent,type,name,defaultvalue,namestring) \
+    v_##name = read##type(settings, #name, defaultvalue);
+
+#define END_ENUM(parents, name)
+#define ADD_TO_ENUM(name,str)
+
+#else
+
 #define ADD_ENUM(type,name,Defaultvalue,namestring) \
     v_##name = std::shared_ptr<Var##type>(new Var##type(namestring,Defaultvalue));
 #define ADD_VALUE(parent,type,name,defaultvalue,namestring) \
@@ -31,11 +54,19 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 #define ADD_TO_ENUM(name,str) \
     v_##name->addItem(str);
 
+#endif
+
 
+#ifdef FIRASIM_HEADLESS
+ConfigWidget::ConfigWidget(bool forceDivisionA, const QString& file)
+{
+  QSettings settings(file, QSettings::IniFormat);
+#else
 ConfigWidget::ConfigWidget(bool forceDivisionA)
 {      
   tmodel=new VarTreeModel();
   this->setModel(tmodel);  
+#endif
   geo_vars = std::make_shared<VarList>("Geometry");
   world.push_back(geo_vars);  
   robot_settings = new QSettings;
@@ -103,6 +134,32 @@ ConfigWidget::ConfigWidget(bool forceDivisionA)
         ADD_VALUE(worldp_vars,Bool,SyncWithGL,false,"Synchronize ODE with OpenGL")
         ADD_VALUE(worldp_vars, Bool, SyncWithPython, false, "Synchronize SimStep with python " )
         ADD_VALUE(worldp_vars,Double,DeltaTime,0.016,"ODE time step")
+        ADD_VALUE(worldp_vars,Bool,FreeRunning,false,"Step on a separate thread, not the frame timer")
+        ADD_VALUE(worldp_vars,Double,RealTimeFactor,0,"Real-time factor cap when free running (0 = unlimited)")
+        ADD_VALUE(worldp_vars,Int,Seed,0,"Random seed (0 = different every run)")
+    VarListPtr solver_vars(new VarList("Solver"));
+    phys_vars->addChild(solver_vars);
+        ADD_ENUM(StringEnum,PhysicsProfile,"custom","Profile")
+        ADD_TO_ENUM(PhysicsProfile,"custom")
+        ADD_TO_ENUM(PhysicsProfile,"accurate")
+        ADD_TO_ENUM(PhysicsProfile,"training")
+        ADD_TO_ENUM(PhysicsProfile,"ultra-fast")
+        END_ENUM(solver_vars,PhysicsProfile)
+        ADD_VALUE(solver_vars,Int,Substeps,5,"Substeps per step")
+        ADD_VALUE(solver_vars,Bool,AdaptiveSubsteps,false,"Fewer substeps while nothing moves fast")
+        ADD_VALUE(solver_vars,Int,MinSubsteps,2,"Substeps while nothing moves fast")
+        ADD_VALUE(solver_vars,Double,AdaptiveSpeedThreshold,0.5,"Fast speed threshold (m/s)")
+        ADD_VALUE(solver_vars,Bool,QuickStep,false,"Iterative solver (dWorldQuickStep)")
+        ADD_VALUE(solver_vars,Int,SolverIterations,20,"Iterative solver iterations")
+        ADD_VALUE(solver_vars,Int,ODEThreads,1,"ODE stepping threads (1 = single threaded)")
+        ADD_VALUE(solver_vars,Int,CollideThreads,1,"Narrow-phase collision threads (1 = single threaded)")
+        ADD_VALUE(solver_vars,Bool,AutoDisable,false,"Let resting bodies sleep")
+        ADD_ENUM(StringEnum,Broadphase,"hash","Broadphase")
+        ADD_TO_ENUM(Broadphase,"hash")
+        ADD_TO_ENUM(Broadphase,"sap")
+        ADD_TO_ENUM(Broadphase,"quadtree")
+        ADD_TO_ENUM(Broadphase,"grid")
+        END_ENUM(solver_vars,Broadphase)
         ADD_VALUE(worldp_vars,Double,Gravity,9.8,"Gravity")
         ADD_VALUE(worldp_vars,Bool,ResetTurnOver,true,"Auto reset turn-over")
   VarListPtr ballp_vars(new VarList("Ball"));
@@ -119,6 +176,9 @@ ConfigWidget::ConfigWidget(bool forceDivisionA)
     ADD_VALUE(comm_vars,String,VisionMulticastAddr,"224.0.0.1","Vision multicast address")  //LocalHost
     ADD_VALUE(comm_vars,Int,VisionMulticastPort,10002,"Vision multicast port")
     ADD_VALUE(comm_vars,Int,CommandListenPort,20011,"Command listen port")
+    ADD_VALUE(comm_vars,Int,SimulatePort,0,"Lock-step simulate port (0 disables)")
+    ADD_VALUE(comm_vars,String,SharedMemoryName,"","Shared memory name, e.g. /firasim (empty disables)")
+    ADD_VALUE(comm_vars,String,RecordFile,"","Record every step to this file (empty disables)")
     ADD_VALUE(comm_vars,Int,BlueStatusSendPort,30011,"Blue Team status send port")
     ADD_VALUE(comm_vars,Int,YellowStatusSendPort,30012,"Yellow Team status send port")
     ADD_VALUE(comm_vars,Int,sendDelay,0,"Sending delay (milliseconds)")
@@ -136,7 +196,7 @@ ConfigWidget::ConfigWidget(bool forceDivisionA)
         ADD_VALUE(vanishing_vars,Double,yellow_team_vanishing,0,"Yellow team")
         ADD_VALUE(vanishing_vars,Double,ball_vanishing,0,"Ball")
 
-
+#ifndef FIRASIM_HEADLESS
     QDir dir;
     std::string blueteam = v_BlueTeam->getString();
     geo_vars->removeChild(v_BlueTeam);
@@ -187,13 +247,20 @@ ConfigWidget::ConfigWidget(bool forceDivisionA)
   resize(320,400);
   connect(v_BlueTeam.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(loadRobotsSettings()));
   connect(v_YellowTeam.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(loadRobotsSettings()));
+  connect(v_PhysicsProfile.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(applyPhysicsProfile()));
+#endif
   loadRobotsSettings();
+  applyPhysicsProfile();
 }
 
 ConfigWidget::~ConfigWidget() {  
+#ifndef FIRASIM_HEADLESS
    VarXML::write(world,(QDir::homePath() + QString("/.grsim.xml")).toStdString());
+#endif
 }
 
+#ifndef FIRASIM_HEADLESS
+
 
 ConfigDockWidget::ConfigDockWidget(QWidget* _parent,ConfigWidget* _conf){
     parent=_parent;conf=_conf;
@@ -204,8 +271,40 @@ void ConfigDockWidget::closeEvent(QCloseEvent* event)
 {
     emit closeSignal(false);
 }
+#endif
 
 
+void ConfigWidget::applyPhysicsProfile()
+{
+    //"custom" keeps whatever the solver values are
+    const std::string profile = PhysicsProfile();
+    if (profile == "accurate")
+    {
+        set_Substeps(5);
+        set_AdaptiveSubsteps(false);
+        set_QuickStep(false);
+        set_AutoDisable(false);
+    }
+    else if (profile == "training")
+    {
+        set_Substeps(5);
+        set_AdaptiveSubsteps(true);
+        set_MinSubsteps(2);
+        set_QuickStep(true);
+        set_SolverIterations(20);
+        set_AutoDisable(true);
+    }
+    else if (profile == "ultra-fast")
+    {
+        set_Substeps(2);
+        set_AdaptiveSubsteps(true);
+        set_MinSubsteps(1);
+        set_QuickStep(true);
+        set_SolverIterations(10);
+        set_AutoDisable(true);
+    }
+}
+
 void ConfigWidget::loadRobotsSettings()
 {
     loadRobotSettings(YellowTeam().c_str());
@@ -126,7 +126,7 @@ GLWidget::~GLWidget() = default;
 void GLWidget::moveRobot()
 {
     ssl->show3DCursor = true;
-    ssl->cursor_radius = cfg->robotSettings.RobotRadius;
+    ssl->cursor_radius = ssl->robotSettings.RobotRadius;
     state = 1;
     moving_robot_id = clicked_robot;
 }
@@ -134,14 +134,15 @@ void GLWidget::moveRobot()
 void GLWidget::unselectRobot()
 {
     ssl->show3DCursor = false;
-    ssl->cursor_radius = cfg->robotSettings.RobotRadius;
+    ssl->cursor_radius = ssl->robotSettings.RobotRadius;
     state = 0;
     moving_robot_id = ssl->robotIndex(Current_robot, Current_team);
 }
 
 void GLWidget::selectRobot()
 {
-    if (clicked_robot != -1)
+    //the robot selector only lists robots with their own texture
+    if (clicked_robot != -1 && clicked_robot % cfg->Robots_Count() < MAX_ROBOT_COUNT)
     {
         Current_robot = clicked_robot % cfg->Robots_Count();
         Current_team = clicked_robot / cfg->Robots_Count();
@@ -153,6 +154,7 @@ void GLWidget::resetRobot()
 {
     if (Current_robot != -1)
     {
+        QMutexLocker locker(&ssl->mutex);
         ssl->robots[ssl->robotIndex(Current_robot, Current_team)]->resetRobot();
     }
 }
@@ -162,15 +164,16 @@ void GLWidget::switchRobotOnOff()
     int k = ssl->robotIndex(Current_robot, Current_team);
     if (Current_robot != -1)
     {
+        QMutexLocker locker(&ssl->mutex);
         if (ssl->robots[k]->on)
         {
-            ssl->robots[k]->on = false;
+            ssl->robots[k]->setOn(false);
             onOffRobotAct->setText("Turn &on");
             emit robotTurnedOnOff(k, false);
         }
         else
         {
-            ssl->robots[k]->on = true;
+            ssl->robots[k]->setOn(true);
             onOffRobotAct->setText("Turn &off");
             emit robotTurnedOnOff(k, true);
         }
@@ -179,13 +182,14 @@ void GLWidget::switchRobotOnOff()
 
 void GLWidget::resetCurrentRobot()
 {
+    QMutexLocker locker(&ssl->mutex);
     ssl->robots[ssl->robotIndex(Current_robot, Current_team)]->resetRobot();
 }
 
 void GLWidget::moveCurrentRobot()
 {
     ssl->show3DCursor = true;
-    ssl->cursor_radius = cfg->robotSettings.RobotRadius;
+    ssl->cursor_radius = ssl->robotSettings.RobotRadius;
     state = 1;
     moving_robot_id = ssl->robotIndex(Current_robot, Current_team);
 }
@@ -204,6 +208,7 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
     lastPos = event->pos();
     if (event->buttons() & Qt::LeftButton)
     {
+        QMutexLocker locker(&ssl->mutex);
         if (state == 1)
         {
             if (moving_robot_id != -1)
@@ -473,6 +478,7 @@ void GLWidget::changeCameraMode()
 
 void GLWidget::putBall(dReal x, dReal y)
 {
+    QMutexLocker locker(&ssl->mutex);
     ssl->ball->setBodyPosition(x, y, 0.3);
     dBodySetLinearVel(ssl->ball->body, 0, 0, 0);
     dBodySetAngularVel(ssl->ball->body, 0, 0, 0);
@@ -512,6 +518,7 @@ void GLWidget::keyPressEvent(QKeyEvent *event)
     if (R < 0)
         return;
 
+    QMutexLocker locker(&ssl->mutex);
     switch (cmd)
     {
     case 't':
@@ -628,6 +635,7 @@ void GLWidget::yellowRobotsMenuTriggered(QAction *act)
 
 void GLWidget::reform(int team, const QString &act)
 {
+    QMutexLocker locker(&ssl->mutex);
     if (act == tr("Put all inside with formation 1"))
         forms[2]->resetRobots(ssl->robots, team);
     if (act == tr("Put all inside with formation 2"))
@@ -644,7 +652,7 @@ void GLWidget::reform(int team, const QString &act)
             int k = ssl->robotIndex(i, team);
             if (ssl->robots[k]->on)
             {
-                ssl->robots[k]->on = false;
+                ssl->robots[k]->setOn(false);
                 onOffRobotAct->setText("Turn &on");
                 emit robotTurnedOnOff(k, false);
             }
@@ -658,7 +666,7 @@ void GLWidget::reform(int team, const QString &act)
             int k = ssl->robotIndex(i, team);
             if (!ssl->robots[k]->on)
             {
-                ssl->robots[k]->on = true;
+                ssl->robots[k]->setOn(true);
                 onOffRobotAct->setText("Turn &off");
                 emit robotTurnedOnOff(k, true);
             }
@@ -0,0 +1,108 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// CGraphics for the headless core: keeps the camera state so callers still
+// get sane values, everything that would touch OpenGL does nothing.
+
+#include "graphics.h"
+
+CGraphics::CGraphics(QGLWidget* _owner)
+{
+    owner = _owner;
+    dReal xyz[3] = {0.8317f,-0.9817f,0.8000f};
+    dReal hpr[3] = {121.0000f,-27.5000f,0.0000f};
+    setViewpoint (xyz,hpr);
+    sphere_quality = 1;
+    m_renderDepth = 100;
+    _width = _height = 1;
+    frustum_right = frustum_bottom = frustum_vnear = 1;
+    graphicDisabled = true;
+}
+
+CGraphics::~CGraphics()
+= default;
+
+void CGraphics::disableGraphics() {}
+void CGraphics::enableGraphics() {}
+bool CGraphics::isGraphicsEnabled() {return false;}
+void CGraphics::setSphereQuality(int q) {sphere_quality = q;}
+int CGraphics::loadTexture(QImage* img) {return -1;}
+int CGraphics::loadTextureSkyBox(QImage* img) {return -1;}
+
+void CGraphics::setViewpoint (const dReal xyz[3], const dReal hpr[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        view_xyz[i] = xyz[i];
+        view_hpr[i] = hpr[i];
+    }
+}
+
+void CGraphics::setViewpoint (dReal x,dReal y,dReal z,dReal h,dReal p,dReal r)
+{
+    const dReal xyz[3] = {x, y, z};
+    const dReal hpr[3] = {h, p, r};
+    setViewpoint(xyz, hpr);
+}
+
+void CGraphics::getViewpoint (dReal* xyz, dReal* hpr)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        xyz[i] = view_xyz[i];
+        hpr[i] = view_hpr[i];
+    }
+}
+
+void CGraphics::getFrustum(dReal& right,dReal& bottom,dReal& vnear)
+{
+    right = frustum_right;
+    bottom = frustum_bottom;
+    vnear = frustum_vnear;
+}
+
+int CGraphics::getWidth() {return _width;}
+int CGraphics::getHeight() {return _height;}
+dReal CGraphics::renderDepth() {return m_renderDepth;}
+void CGraphics::setRenderDepth(dReal depth) {m_renderDepth = depth;}
+void CGraphics::cameraMotion (int mode, int deltax, int deltay) {}
+void CGraphics::lookAt(dReal x,dReal y,dReal z) {}
+void CGraphics::getCameraForward(dReal& x,dReal& y,dReal& z) {x = 1; y = z = 0;}
+void CGraphics::getCameraRight(dReal& x,dReal& y,dReal& z) {y = 1; x = z = 0;}
+void CGraphics::zoomCamera(dReal dz) {}
+void CGraphics::setColor (dReal r, dReal g, dReal b, dReal alpha) {}
+void CGraphics::setShadow(bool state) {}
+void CGraphics::useTexture(int tex_id) {}
+void CGraphics::noTexture() {}
+void CGraphics::setTransform (const dReal pos[3], const dReal R[12]) {}
+void CGraphics::setTransformD (const double pos[3], const double R[12]) {}
+void CGraphics::initScene(int width,int height,dReal rc,dReal gc,dReal bc,bool fog,dReal fogr,dReal fogg,dReal fogb,dReal fogdensity) {}
+void CGraphics::finalizeScene() {}
+void CGraphics::resetState() {}
+void CGraphics::drawSkybox(int t1,int t2,int t3,int t4,int t5,int t6) {}
+void CGraphics::drawSky () {}
+void CGraphics::drawGround() {}
+void CGraphics::drawSSLGround(dReal SSL_FIELD_RAD,dReal SSL_FIELD_LENGTH,dReal SSL_FIELD_WIDTH,dReal SSL_FIELD_PENALTY_DEPTH,dReal SSL_FIELD_PENALTY_WIDTH,dReal SSL_FIELD_PENALTY_POINT, dReal SSL_FIELD_LINE_WIDTH, dReal epsilon) {}
+void CGraphics::drawBox (const dReal pos[3], const dReal R[12],const dReal sides[3]) {}
+void CGraphics::drawBox_TopTextured(const dReal pos[3], const dReal R[12], const dReal sides[3], int tex_id,bool robot) {}
+void CGraphics::drawSphere (const dReal pos[3], const dReal R[12],dReal radius) {}
+void CGraphics::drawCylinder (const dReal pos[3], const dReal R[12],dReal length, dReal radius) {}
+void CGraphics::drawCylinder_TopTextured (const dReal pos[3], const dReal R[12],dReal length, dReal radius,int tex_id,bool robot) {}
+void CGraphics::drawCapsule (const dReal pos[3], const dReal R[12],dReal length, dReal radius) {}
+void CGraphics::drawLine (const dReal pos1[3], const dReal pos2[3]) {}
+void CGraphics::drawCircle(dReal x0,dReal y0,dReal z0,dReal r) {}
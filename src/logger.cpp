@@ -18,6 +18,17 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 
 #include "logger.h"
 
+#ifdef FIRASIM_HEADLESS
+#include <cstdio>
+void initLogger(void* v)
+{
+}
+
+void logStatus(QString s,QColor c)
+{
+    fprintf(stderr, "%s\n", qPrintable(s));
+}
+#else
 #include <utility>
 #include "statuswidget.h"
 CStatusPrinter *printer;
@@ -30,4 +41,5 @@ void logStatus(QString s,QColor c)
 {    
     printer->textBuffer.enqueue(CStatusText(std::move(s),std::move(c)));
 }
+#endif
 
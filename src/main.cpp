@@ -16,6 +16,7 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <QtWidgets/QApplication>
+#include <cstdlib>
 #include "mainwindow.h"
 #include "winmain.h"
 
@@ -50,5 +51,8 @@ int main(int argc, char *argv[])
         w.withGoalKick(true);
     if(std::find(argv, argend, std::string("--xlr8")) != argend)
         w.fullSpeed(true);
+    char** seed_arg = std::find(argv, argend, std::string("--seed"));
+    if (seed_arg != argend && seed_arg + 1 != argend)
+        w.setSeed(atoi(*(seed_arg + 1)));
     return QApplication::exec();
 }
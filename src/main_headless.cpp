@@ -0,0 +1,161 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <QCoreApplication>
+#include <QTimer>
+#include <QUdpSocket>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#ifdef HAVE_UNIX
+#include <csignal>
+#endif
+
+#include "sslworld.h"
+#include "net/simulate_server.h"
+#include "simthread.h"
+#include "replay.h"
+#include "profiler.h"
+
+#ifdef HAVE_UNIX
+//set from signal handlers and polled by the event loop, where quitting is safe
+static std::atomic<int> pending_signal{0};
+static void onSignal(int sig)
+{
+    pending_signal = sig;
+}
+#endif
+
+// firasim-core: the simulator without window, OpenGL context or VarTypes.
+// Configuration comes from the ini file given with --config, see config/core/default.ini.
+int main(int argc, char *argv[])
+{
+    char** argend = argc + argv;
+
+    QCoreApplication::setOrganizationName("Parsian");
+    QCoreApplication::setOrganizationDomain("parsian-robotics.com");
+    QCoreApplication::setApplicationName("grSim");
+    QCoreApplication a(argc, argv);
+
+    bool forceDivisionA = false;
+    if(std::find(argv, argend, std::string("--5v5")) != argend) {
+        forceDivisionA = true;
+    }
+    QString config_file;
+    char** config_arg = std::find(argv, argend, std::string("--config"));
+    if (config_arg != argend && config_arg + 1 != argend)
+        config_file = QString(*(config_arg + 1));
+
+    ConfigWidget cfg(forceDivisionA, config_file);
+
+#ifdef HAVE_UNIX
+    //SIGINT and SIGTERM leave exec() normally, so recorders flush and the profile is printed;
+    //SIGUSR1 prints the profile while running
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGUSR1, onSignal);
+    QTimer signalTimer;
+    QObject::connect(&signalTimer, &QTimer::timeout, [&]() {
+        const int sig = pending_signal.exchange(0);
+        if (sig == SIGUSR1)
+            std::cerr << Profiler::instance().report().toStdString();
+        else if (sig != 0)
+            QCoreApplication::quit();
+    });
+    signalTimer.start(100);
+#endif
+    char** seed_arg = std::find(argv, argend, std::string("--seed"));
+    if (seed_arg != argend && seed_arg + 1 != argend)
+        cfg.set_Seed(atoi(*(seed_arg + 1)));
+
+    //replay mode streams a recorded match instead of simulating one
+    char** replay_arg = std::find(argv, argend, std::string("--replay"));
+    if (replay_arg != argend && replay_arg + 1 != argend) {
+        RoboCupSSLServer replayServer;
+        replayServer.change_address(cfg.VisionMulticastAddr());
+        replayServer.change_port(cfg.VisionMulticastPort());
+        ReplayStreamer replay(&replayServer);
+        if (!replay.open(QString(*(replay_arg + 1))))
+            return 1;
+        char** speed_arg = std::find(argv, argend, std::string("--speed"));
+        if (speed_arg != argend && speed_arg + 1 != argend)
+            replay.setSpeed(atof(*(speed_arg + 1)));
+        char** seek_arg = std::find(argv, argend, std::string("--seek"));
+        if (seek_arg != argend && seek_arg + 1 != argend && !replay.seek(atoi(*(seek_arg + 1))))
+            logStatus(QString("Frame %1 is not in the log").arg(*(seek_arg + 1)), QColor("red"));
+        replay.setLoop(std::find(argv, argend, std::string("--loop")) != argend);
+        replay.setGeometryEvery(cfg.sendGeometryEvery());
+        QObject::connect(&replay, &ReplayStreamer::finished, &a, &QCoreApplication::quit);
+        replay.start();
+        return QCoreApplication::exec();
+    }
+    RobotsFormation form(cfg.Division() == "Division A" ? 3 : 4, &cfg);
+    SSLWorld world(nullptr, &cfg, &form);
+
+    RoboCupSSLServer visionServer;
+    visionServer.change_address(cfg.VisionMulticastAddr());
+    visionServer.change_port(cfg.VisionMulticastPort());
+    world.visionServer = &visionServer;
+
+    QUdpSocket commandSocket;
+    if (commandSocket.bind(QHostAddress::Any, cfg.CommandListenPort()))
+        logStatus(QString("Command listen port binded on: %1").arg(cfg.CommandListenPort()), QColor("green"));
+    QObject::connect(&commandSocket, SIGNAL(readyRead()), &world, SLOT(recvActions()));
+    world.commandSocket = &commandSocket;
+
+    SimulateServer simulateServer;
+    simulateServer.setWorld(&world);
+    simulateServer.listen(cfg.SimulatePort());
+
+    ShmChannel shmChannel;
+    if (!cfg.SharedMemoryName().empty() && shmChannel.open(cfg.SharedMemoryName(), true))
+        world.shmChannel = &shmChannel;
+
+    char** record_arg = std::find(argv, argend, std::string("--record"));
+    if (record_arg != argend && record_arg + 1 != argend)
+        cfg.set_RecordFile(*(record_arg + 1));
+    MatchRecorder recorder;
+    if (!cfg.RecordFile().empty() && recorder.open(QString::fromStdString(cfg.RecordFile()), &world))
+        world.recorder = &recorder;
+
+    if(std::find(argv, argend, std::string("--atkfault")) != argend)
+        world.withGoalKick = true;
+    if(std::find(argv, argend, std::string("--xlr8")) != argend) {
+        world.fullSpeed = true;
+        cfg.v_FreeRunning = true;
+    }
+
+    //free running steps on its own thread, otherwise one step per DesiredFPS tick
+    SimThread simThread(&cfg);
+    QTimer timer;
+    if (cfg.FreeRunning()) {
+        simThread.setWorld(&world);
+        simThread.startStepping();
+    } else {
+        timer.setInterval(ceil(1000.0 / cfg.DesiredFPS()));
+        QObject::connect(&timer, &QTimer::timeout, [&]() { world.step(cfg.DeltaTime()); });
+        timer.start();
+    }
+    const int result = QCoreApplication::exec();
+    simThread.stopStepping();
+#ifdef FIRASIM_PROFILER
+    std::cerr << Profiler::instance().report().toStdString();
+#endif
+    return result;
+}
@@ -34,9 +34,11 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 
 #include <QStatusBar>
 #include <QMessageBox>
+#include <iostream>
 
 #include "mainwindow.h"
 #include "logger.h"
+#include "profiler.h"
 
 int MainWindow::getInterval()
 {
@@ -82,6 +84,19 @@ MainWindow::MainWindow(bool forceDivisionA, QWidget *parent)
     glwidget->ssl->visionServer = visionServer;
     glwidget->ssl->commandSocket = commandSocket;
 
+    simulateServer = new SimulateServer(this);
+    simulateServer->setWorld(glwidget->ssl);
+    reconnectSimulateServer();
+
+    shmChannel = new ShmChannel();
+    reconnectSharedMemory();
+
+    recorder = new MatchRecorder();
+    reconnectRecorder();
+
+    simThread = new SimThread(configwidget, this);
+    simThread->setWorld(glwidget->ssl);
+
     robotwidget = new RobotWidget(this, configwidget);
     /* Status Bar */
     fpslabel = new QLabel(this);
@@ -155,6 +170,11 @@ MainWindow::MainWindow(bool forceDivisionA, QWidget *parent)
     fullScreenAct->setCheckable(true);
     fullScreenAct->setChecked(false);
     simulatorMenu->addAction(fullScreenAct);
+#ifdef FIRASIM_PROFILER
+    auto *profilerAct = new QAction(tr("&Profiler report"), simulatorMenu);
+    simulatorMenu->addAction(profilerAct);
+    QObject::connect(profilerAct, SIGNAL(triggered(bool)), this, SLOT(showProfilerReport()));
+#endif
 
     viewMenu->addAction(robotwidget->toggleViewAction());
     viewMenu->addMenu(glwidget->cameraMenu);
@@ -209,6 +229,7 @@ MainWindow::MainWindow(bool forceDivisionA, QWidget *parent)
     QObject::connect(configwidget->v_DesiredFPS.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(changeTimer()));
     QObject::connect(configwidget->v_Division.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(restartSimulator()));
     QObject::connect(configwidget->v_Robots_Count.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(restartSimulator()));
+    QObject::connect(configwidget->v_Broadphase.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(restartSimulator()));
 
     QObject::connect(configwidget->v_DivA_Field_Line_Width.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(restartSimulator()));
     QObject::connect(configwidget->v_DivA_Field_Length.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(restartSimulator()));
@@ -249,6 +270,13 @@ MainWindow::MainWindow(bool forceDivisionA, QWidget *parent)
     QObject::connect(configwidget->v_VisionMulticastAddr.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(reconnectVisionSocket()));
     QObject::connect(configwidget->v_VisionMulticastPort.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(reconnectVisionSocket()));
     QObject::connect(configwidget->v_CommandListenPort.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(reconnectCommandSocket()));
+    QObject::connect(configwidget->v_SimulatePort.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(reconnectSimulateServer()));
+    QObject::connect(configwidget->v_SharedMemoryName.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(reconnectSharedMemory()));
+    QObject::connect(configwidget->v_RecordFile.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(reconnectRecorder()));
+    QObject::connect(configwidget->v_FreeRunning.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(changeFreeRunning()));
+    QObject::connect(configwidget->v_Seed.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(changeSeed()));
+    QObject::connect(configwidget->v_ODEThreads.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(changeODEThreads()));
+    QObject::connect(configwidget->v_CollideThreads.get(), SIGNAL(wasEdited(VarPtr)), this, SLOT(changeCollideThreads()));
     timer->start();
 
 
@@ -263,7 +291,16 @@ MainWindow::MainWindow(bool forceDivisionA, QWidget *parent)
 }
 
 MainWindow::~MainWindow()
-= default;
+{
+    simThread->stopStepping();
+    glwidget->ssl->shmChannel = nullptr;
+    delete shmChannel;
+    glwidget->ssl->recorder = nullptr;
+    delete recorder;
+#ifdef FIRASIM_PROFILER
+    std::cerr << Profiler::instance().report().toStdString();
+#endif
+}
 
 void MainWindow::showHideConfig(bool v)
 {
@@ -295,6 +332,7 @@ void MainWindow::changeCurrentTeam()
 
 void MainWindow::changeGravity()
 {
+    QMutexLocker locker(&glwidget->ssl->mutex);
     dWorldSetGravity (glwidget->ssl->p->world,0,0,-configwidget->Gravity());
 }
 
@@ -337,6 +375,10 @@ void MainWindow::update()
     QString ss;
     scorelabel->setText(QString("BLUE %1 x %2 YELLOW").arg(glwidget->ssl->goals_blue).arg(glwidget->ssl->goals_yellow));
     fpslabel->setText(QString("Frame rate: %1 fps").arg(ss.sprintf("%06.2f",glwidget->getFPS())));        
+    if (simThread->isRunning())
+        fpslabel->setText(fpslabel->text() + QString(", %1 steps/s").arg(simThread->stepRate(),0,'f',0));
+    if (configwidget->AutoDisable())
+        fpslabel->setText(fpslabel->text() + QString(", %1/%2 bodies asleep").arg(glwidget->ssl->p->sleepingBodyCount()).arg(glwidget->ssl->p->bodyCount()));
     if (glwidget->ssl->selected!=-1)
     {
         selectinglabel->setVisible(true);
@@ -371,12 +413,14 @@ void MainWindow::updateRobotLabel()
 
 void MainWindow::changeBallMass()
 {
+    QMutexLocker locker(&glwidget->ssl->mutex);
     glwidget->ssl->ball->setMass(configwidget->BallMass());
 }
 
 
 void MainWindow::changeBallGroundSurface()
 {
+    QMutexLocker locker(&glwidget->ssl->mutex);
     PSurface* ballwithwall = glwidget->ssl->p->findSurface(glwidget->ssl->ball,glwidget->ssl->ground);
     ballwithwall->surface.mode = dContactBounce | dContactApprox1 | dContactSlip1 | dContactSlip2;
     ballwithwall->surface.mu = fric(configwidget->BallFriction());
@@ -388,6 +432,7 @@ void MainWindow::changeBallGroundSurface()
 
 void MainWindow::changeBallDamping()
 {
+    QMutexLocker locker(&glwidget->ssl->mutex);
     dBodySetLinearDampingThreshold(glwidget->ssl->ball->body,0.001);
     dBodySetLinearDamping(glwidget->ssl->ball->body,configwidget->BallLinearDamp());
     dBodySetAngularDampingThreshold(glwidget->ssl->ball->body,0.001);
@@ -396,6 +441,9 @@ void MainWindow::changeBallDamping()
 
 void MainWindow::restartSimulator()
 {        
+    const bool freeRunning = simThread->isRunning();
+    simThread->stopStepping();
+    simulateServer->setWorld(nullptr);
     delete glwidget->ssl;
    
     if(configwidget->Division() == "Division A") {
@@ -412,6 +460,16 @@ void MainWindow::restartSimulator()
     glwidget->ssl->glinit();
     glwidget->ssl->visionServer = visionServer;
     glwidget->ssl->commandSocket = commandSocket;
+    glwidget->ssl->shmChannel = shmChannel->isOpen() ? shmChannel : nullptr;
+    if (recorder->isOpen() && !MatchRecorder::supports(configwidget->Robots_Count()))
+        recorder->close();
+    glwidget->ssl->recorder = recorder->isOpen() ? recorder : nullptr;
+    simulateServer->setWorld(glwidget->ssl);
+    simThread->setWorld(glwidget->ssl);
+    if (freeRunning) simThread->startStepping();
+
+    robotwidget->setRobotCount(configwidget->Robots_Count());
+    changeCurrentRobot();
 
 }
 
@@ -467,6 +525,7 @@ void MainWindow::setCurrentRobotPosition()
     if (!ok1) {logStatus("Invalid dReal for x",QColor("red"));return;}
     if (!ok2) {logStatus("Invalid dReal for y",QColor("red"));return;}
     if (!ok3) {logStatus("Invalid dReal for angle",QColor("red"));return;}
+    QMutexLocker locker(&glwidget->ssl->mutex);
     glwidget->ssl->robots[i]->setXY(x,y);
     glwidget->ssl->robots[i]->setDir(a);
     robotwidget->getPoseWidget->close();
@@ -516,6 +575,39 @@ void MainWindow::reconnectVisionSocket()
     //sendBuffer();
 }
 
+void MainWindow::reconnectSimulateServer()
+{
+    simulateServer->listen(configwidget->SimulatePort());
+}
+
+void MainWindow::reconnectSharedMemory()
+{
+    QMutexLocker locker(&glwidget->ssl->mutex);
+    glwidget->ssl->shmChannel = nullptr;
+    shmChannel->close();
+    if (configwidget->SharedMemoryName().empty())
+        return;
+    if (shmChannel->open(configwidget->SharedMemoryName(), true))
+        glwidget->ssl->shmChannel = shmChannel;
+}
+
+void MainWindow::showProfilerReport()
+{
+    for (const QString &line : Profiler::instance().report().split('\n', QString::SkipEmptyParts))
+        logStatus(line, QColor("black"));
+}
+
+void MainWindow::reconnectRecorder()
+{
+    QMutexLocker locker(&glwidget->ssl->mutex);
+    glwidget->ssl->recorder = nullptr;
+    recorder->close();
+    if (configwidget->RecordFile().empty())
+        return;
+    if (recorder->open(QString::fromStdString(configwidget->RecordFile()), glwidget->ssl))
+        glwidget->ssl->recorder = recorder;
+}
+
 void MainWindow::recvActions()
 {
     glwidget->ssl->recvActions();
@@ -539,4 +631,38 @@ void MainWindow::withGoalKick(bool value)
 void MainWindow::fullSpeed(bool value)
 {
     glwidget->ssl->fullSpeed = value;
+    configwidget->v_FreeRunning->setBool(value);
+    changeFreeRunning();
+}
+
+void MainWindow::changeFreeRunning()
+{
+    if (configwidget->FreeRunning())
+        simThread->startStepping();
+    else
+        simThread->stopStepping();
+}
+
+void MainWindow::changeSeed()
+{
+    QMutexLocker locker(&glwidget->ssl->mutex);
+    glwidget->ssl->setSeed(configwidget->Seed());
+}
+
+void MainWindow::changeODEThreads()
+{
+    QMutexLocker locker(&glwidget->ssl->mutex);
+    glwidget->ssl->p->setThreads(configwidget->ODEThreads());
+}
+
+void MainWindow::changeCollideThreads()
+{
+    QMutexLocker locker(&glwidget->ssl->mutex);
+    glwidget->ssl->p->setCollideThreads(configwidget->CollideThreads());
+}
+
+void MainWindow::setSeed(int seed)
+{
+    configwidget->v_Seed->setInt(seed);
+    changeSeed();
 }
@@ -61,16 +61,22 @@ void RoboCupSSLServer::change_interface(const string & net_interface)
 
 bool RoboCupSSLServer::send(const fira_message::sim_to_ref::Environment & env)
 {
-    QByteArray datagram;
-
-    datagram.resize(env.ByteSize());
-    bool success = env.SerializeToArray(datagram.data(), datagram.size());
-    if(!success) {
-        //TODO: print useful info
-        logStatus(QString("Serializing packet to array failed."), QColor("red"));
+    mutex.lock();
+    //_buffer keeps its capacity, so steady state sending does not allocate
+    _buffer.resize(env.ByteSize());
+    env.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8 *>(_buffer.data()));
+    qint64 bytes_sent = _socket->writeDatagram(_buffer, *_net_address, _port);
+    mutex.unlock();
+    if (bytes_sent != _buffer.size()) {
+        logStatus(QString("Sending UDP datagram failed (maybe too large?). Size was: %1 byte(s).").arg(_buffer.size()), QColor("red"));
         return false;
     }
 
+    return true;
+}
+
+bool RoboCupSSLServer::send(const QByteArray & datagram)
+{
     mutex.lock();
     qint64 bytes_sent = _socket->writeDatagram(datagram, *_net_address, _port);
     mutex.unlock();
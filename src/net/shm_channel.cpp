@@ -0,0 +1,196 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "net/shm_channel.h"
+
+#include <cstring>
+
+#ifdef HAVE_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "logger.h"
+
+ShmChannel::ShmChannel()
+{
+    segment = nullptr;
+    owner = false;
+}
+
+ShmChannel::~ShmChannel()
+{
+    close();
+}
+
+bool ShmChannel::isOpen() const
+{
+    return segment != nullptr;
+}
+
+#ifdef HAVE_UNIX
+bool ShmChannel::open(const std::string &name, bool create)
+{
+    close();
+    int fd = shm_open(name.c_str(), create ? (O_CREAT | O_RDWR) : O_RDWR, 0600);
+    if (fd < 0)
+    {
+        logStatus(QString("Could not open shared memory %1").arg(name.c_str()), QColor("red"));
+        return false;
+    }
+    if (create && ftruncate(fd, sizeof(ShmSegment)) != 0)
+    {
+        ::close(fd);
+        logStatus(QString("Could not size shared memory %1").arg(name.c_str()), QColor("red"));
+        return false;
+    }
+    void *mem = mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+    {
+        logStatus(QString("Could not map shared memory %1").arg(name.c_str()), QColor("red"));
+        return false;
+    }
+    segment = static_cast<ShmSegment *>(mem);
+    segment_name = name;
+    owner = create;
+    if (create)
+    {
+        memset(&segment->state, 0, sizeof(ShmState));
+        segment->sequence.store(0, std::memory_order_relaxed);
+        segment->command_head.store(0, std::memory_order_relaxed);
+        segment->command_tail.store(0, std::memory_order_relaxed);
+        segment->version = SHM_VERSION;
+        std::atomic_thread_fence(std::memory_order_release);
+        segment->magic = SHM_MAGIC;
+        logStatus(QString("Shared memory state published on %1").arg(name.c_str()), QColor("green"));
+    }
+    else if (segment->magic != SHM_MAGIC || segment->version != SHM_VERSION)
+    {
+        logStatus(QString("Shared memory %1 has an unknown layout").arg(name.c_str()), QColor("red"));
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ShmChannel::close()
+{
+    if (segment == nullptr)
+        return;
+    munmap(segment, sizeof(ShmSegment));
+    if (owner)
+        shm_unlink(segment_name.c_str());
+    segment = nullptr;
+    owner = false;
+}
+#else
+bool ShmChannel::open(const std::string &name, bool create)
+{
+    logStatus("Shared memory channel is only available on POSIX systems", QColor("red"));
+    return false;
+}
+
+void ShmChannel::close()
+{
+}
+#endif
+
+static void copyRobot(ShmRobot &dst, const fira_message::Robot &src)
+{
+    dst.robot_id = src.robot_id();
+    dst.present = 1;
+    dst.x = src.x();
+    dst.y = src.y();
+    dst.orientation = src.orientation();
+    dst.vx = src.vx();
+    dst.vy = src.vy();
+    dst.vorientation = src.vorientation();
+}
+
+void ShmChannel::publish(const fira_message::sim_to_ref::Environment &env, int robots_per_team)
+{
+    if (segment == nullptr)
+        return;
+    //seqlock: readers retry while the sequence is odd or changed under them
+    const uint32_t seq = segment->sequence.load(std::memory_order_relaxed);
+    segment->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ShmState &s = segment->state;
+    s.step = env.step();
+    s.goals_blue = env.goals_blue();
+    s.goals_yellow = env.goals_yellow();
+    s.robots_per_team = robots_per_team;
+    const fira_message::Ball &ball = env.frame().ball();
+    s.ball.x = ball.x();
+    s.ball.y = ball.y();
+    s.ball.z = ball.z();
+    s.ball.vx = ball.vx();
+    s.ball.vy = ball.vy();
+    for (int i = 0; i < SHM_MAX_ROBOTS; i++)
+        s.blue[i].present = s.yellow[i].present = 0;
+    for (const auto &r : env.frame().robots_blue())
+        if (r.robot_id() < SHM_MAX_ROBOTS)
+            copyRobot(s.blue[r.robot_id()], r);
+    for (const auto &r : env.frame().robots_yellow())
+        if (r.robot_id() < SHM_MAX_ROBOTS)
+            copyRobot(s.yellow[r.robot_id()], r);
+
+    segment->sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool ShmChannel::popCommand(ShmCommand &cmd)
+{
+    if (segment == nullptr)
+        return false;
+    const uint32_t tail = segment->command_tail.load(std::memory_order_relaxed);
+    if (tail == segment->command_head.load(std::memory_order_acquire))
+        return false;
+    cmd = segment->commands[tail % SHM_COMMAND_RING];
+    segment->command_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+uint32_t ShmChannel::readState(ShmState &state) const
+{
+    if (segment == nullptr)
+        return 0;
+    uint32_t before, after;
+    do
+    {
+        before = segment->sequence.load(std::memory_order_acquire);
+        memcpy(&state, &segment->state, sizeof(ShmState));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = segment->sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return after;
+}
+
+bool ShmChannel::pushCommand(const ShmCommand &cmd)
+{
+    if (segment == nullptr)
+        return false;
+    const uint32_t head = segment->command_head.load(std::memory_order_relaxed);
+    if (head - segment->command_tail.load(std::memory_order_acquire) >= SHM_COMMAND_RING)
+        return false;
+    segment->commands[head % SHM_COMMAND_RING] = cmd;
+    segment->command_head.store(head + 1, std::memory_order_release);
+    return true;
+}
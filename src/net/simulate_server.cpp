@@ -0,0 +1,152 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "net/simulate_server.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include "sslworld.h"
+#include "logger.h"
+
+#define SIMULATE_MAX_MESSAGE (1 << 20)
+
+SimulateServer::SimulateServer(QObject *parent)
+    : QObject(parent)
+{
+    server = new QTcpServer(this);
+    client = nullptr;
+    world = nullptr;
+    connect(server, SIGNAL(newConnection()), this, SLOT(acceptClient()));
+}
+
+SimulateServer::~SimulateServer()
+{
+    close();
+}
+
+bool SimulateServer::listen(quint16 port)
+{
+    close();
+    if (port == 0) return false;
+    if (!server->listen(QHostAddress::Any, port))
+    {
+        logStatus(QString("Simulate server could not listen on port %1: %2").arg(port).arg(server->errorString()), QColor("red"));
+        return false;
+    }
+    logStatus(QString("Simulate server listening on port %1").arg(port), QColor("green"));
+    return true;
+}
+
+void SimulateServer::close()
+{
+    if (client != nullptr)
+    {
+        client->disconnect(this);
+        client->abort();
+        client->deleteLater();
+        client = nullptr;
+        if (world != nullptr) world->lockStep = false;
+    }
+    server->close();
+}
+
+void SimulateServer::setWorld(SSLWorld *w)
+{
+    if (world != nullptr) world->lockStep = false;
+    world = w;
+    if (world != nullptr) world->lockStep = hasClient();
+}
+
+bool SimulateServer::hasClient() const
+{
+    return client != nullptr;
+}
+
+void SimulateServer::acceptClient()
+{
+    while (server->hasPendingConnections())
+    {
+        QTcpSocket *socket = server->nextPendingConnection();
+        if (client != nullptr)
+        {
+            //only one client may drive the world at a time
+            socket->close();
+            socket->deleteLater();
+            continue;
+        }
+        client = socket;
+        client->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        in_buffer.clear();
+        connect(client, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(dropClient()));
+        if (world != nullptr)
+        {
+            world->lockStep = true;
+            world->requestGeometry();
+        }
+        logStatus(QString("Simulate client connected from %1").arg(client->peerAddress().toString()), QColor("green"));
+    }
+}
+
+void SimulateServer::dropClient()
+{
+    if (client == nullptr) return;
+    client->deleteLater();
+    client = nullptr;
+    if (world != nullptr) world->lockStep = false;
+    logStatus("Simulate client disconnected", QColor("orange"));
+}
+
+void SimulateServer::readRequests()
+{
+    if (client == nullptr) return;
+    in_buffer.append(client->readAll());
+    while (in_buffer.size() >= 4)
+    {
+        const quint32 size = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(in_buffer.constData()));
+        if (size > SIMULATE_MAX_MESSAGE)
+        {
+            logStatus(QString("Simulate request too large (%1 bytes), dropping client").arg(size), QColor("red"));
+            client->abort();
+            return;
+        }
+        if (in_buffer.size() < 4 + static_cast<int>(size)) break;
+        bool ok = request.ParseFromArray(in_buffer.constData() + 4, size);
+        in_buffer.remove(0, 4 + size);
+        if (!ok)
+        {
+            logStatus("Simulate request could not be parsed", QColor("red"));
+            client->abort();
+            return;
+        }
+        if (world == nullptr) continue;
+        world->simulate(request, &response);
+        reply(response);
+    }
+}
+
+void SimulateServer::reply(const fira_message::sim_to_ref::Environment &env)
+{
+    const int size = env.ByteSize();
+    out_buffer.resize(4 + size);
+    qToBigEndian<quint32>(size, reinterpret_cast<uchar *>(out_buffer.data()));
+    env.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8 *>(out_buffer.data() + 4));
+    client->write(out_buffer);
+}
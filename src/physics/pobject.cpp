@@ -75,7 +75,7 @@ void PObject::setRotation(dReal x_axis,dReal y_axis,dReal z_axis,dReal ang)
 
 void PObject::setBodyPosition(dReal x,dReal y,dReal z,bool local)
 {
-    if (!local) dBodySetPosition(body,x,y,z);
+    if (!local) {dBodySetPosition(body,x,y,z);dBodyEnable(body);} //a moved body has to be simulated again
     else {local_Pos[0]=x;local_Pos[1]=y;local_Pos[2]=z;}
 }
 
@@ -85,6 +85,7 @@ void PObject::setBodyRotation(dReal x_axis,dReal y_axis,dReal z_axis,dReal ang,b
     {
         dQFromAxisAndAngle (q,x_axis,y_axis,z_axis,ang);
         dBodySetQuaternion(body,q);
+        dBodyEnable(body);
     }
     else {
         dRFromAxisAndAngle(local_Rot,x_axis,y_axis,z_axis,ang);
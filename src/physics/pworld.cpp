@@ -17,45 +17,132 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 */
 
 #include "pworld.h"
+#include "profiler.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+    //ODE library init is process wide, so it is reference counted between worlds
+    std::mutex ode_init_mutex;
+    int ode_init_count = 0;
+    //bumped on every dInitODE2, per thread data allocated in an older epoch was freed by dCloseODE
+    std::atomic<unsigned> ode_init_epoch{0};
+    //dRandSetSeed/dRandGetSeed share one generator, worlds stepped in parallel take turns with it
+    std::mutex ode_rand_mutex;
+}
+
 PSurface::PSurface()
 {
     callback = nullptr;
+    data = nullptr;
     usefdir1 = false;
     surface.mode = dContactApprox1;
     surface.mu = 0.5;
 }
-bool PSurface::isIt(dGeomID i1, dGeomID i2)
+bool PSurface::isIt(PClass c1, PClass c2)
 {
-    return ((i1 == id1) && (i2 == id2)) || ((i1 == id2) && (i2 == id1));
+    return ((c1 == class1) && (c2 == class2)) || ((c1 == class2) && (c2 == class1));
 }
 
 void nearCallback(void *data, dGeomID o1, dGeomID o2)
 {
-    ((PWorld *)data)->handleCollisions(o1, o2);
+    ((PWorld *)data)->addPair(o1, o2);
 }
 
-PWorld::PWorld(dReal dt, dReal gravity, CGraphics *graphics, int _robot_count)
+PWorld::PWorld(dReal dt, dReal gravity, CGraphics *graphics, int _robot_count, const PBroadphase &bp)
 {
     robot_count = _robot_count;
-    //dInitODE2(0);
-    dInitODE();
+    broadphase = bp;
+    grid_nx = grid_ny = 1;
+    {
+        std::lock_guard<std::mutex> lock(ode_init_mutex);
+        if (ode_init_count++ == 0)
+        {
+            dInitODE2(0);
+            ++ode_init_epoch;
+        }
+    }
+    initThread();
     world = dWorldCreate();
-    space = dHashSpaceCreate(nullptr);
+    switch (broadphase.type)
+    {
+    case PBroadphaseSAP:
+        space = dSweepAndPruneSpaceCreate(nullptr, dSAP_AXES_XYZ);
+        break;
+    case PBroadphaseQuadTree:
+    {
+        const dVector3 center = {0, 0, 0, 0};
+        const dVector3 extents = {broadphase.half_length, broadphase.half_width, 1, 0};
+        space = dQuadTreeSpaceCreate(nullptr, center, extents, 4);
+        break;
+    }
+    case PBroadphaseGrid:
+        //the simple space only stores the geoms, gridCollide() finds the pairs
+        space = dSimpleSpaceCreate(nullptr);
+        grid_nx = qMax(1, static_cast<int>(ceil(2 * broadphase.half_length / broadphase.cell)));
+        grid_ny = qMax(1, static_cast<int>(ceil(2 * broadphase.half_width / broadphase.cell)));
+        break;
+    default:
+        space = dHashSpaceCreate(nullptr);
+    }
     contactgroup = dJointGroupCreate(0);
     dWorldSetGravity(world, 0, 0, -gravity);
-    objects_count = 0;
-    sur_matrix = nullptr;
-    //dAllocateODEDataForThread(dAllocateMaskAll);
+    dWorldSetQuickStepNumIterations(world, 20);
+    threading = nullptr;
+    thread_pool = nullptr;
+    thread_count = 1;
+    collide_pool = nullptr;
+    auto_disable = false;
+    for (int i = 0; i < PClassCount * PClassCount; i++)
+        sur_table[i] = -1;
+    for (int i = 0; i < PClassCount; i++)
+        collide_bits[i] = 0;
+    ode_seed = 0;
     delta_time = dt;
     g = graphics;
 }
 
 PWorld::~PWorld()
 {
+    setThreads(1);
+    delete collide_pool;
     dJointGroupDestroy(contactgroup);
+    for (dSpaceID s : detached_spaces)
+        dSpaceDestroy(s);
     dSpaceDestroy(space);
     dWorldDestroy(world);
-    dCloseODE();
+    std::lock_guard<std::mutex> lock(ode_init_mutex);
+    if (--ode_init_count == 0)
+        dCloseODE();
+}
+
+void PWorld::initThread()
+{
+    //every thread that steps or collides needs its own ODE data
+    thread_local unsigned allocated_epoch = 0;
+    const unsigned epoch = ode_init_epoch;
+    if (allocated_epoch != epoch)
+    {
+        dAllocateODEDataForThread(dAllocateMaskAll);
+        allocated_epoch = epoch;
+    }
+}
+
+void PWorld::detachSpace(dSpaceID s)
+{
+    dSpaceRemove(space, (dGeomID)s);
+    detached_spaces.append(s);
+}
+
+void PWorld::attachSpace(dSpaceID s)
+{
+    detached_spaces.removeOne(s);
+    dSpaceAdd(space, (dGeomID)s);
 }
 
 void PWorld::setGravity(dReal gravity)
@@ -63,52 +150,168 @@ void PWorld::setGravity(dReal gravity)
     dWorldSetGravity(world, 0, 0, -gravity);
 }
 
-void PWorld::handleCollisions(dGeomID o1, dGeomID o2)
+void PWorld::setSeed(uint64_t seed)
+{
+    ode_seed = static_cast<unsigned long>(seed);
+}
+
+unsigned long PWorld::getSeed() const
+{
+    return ode_seed;
+}
+
+int PWorld::bodyCount() const
+{
+    int count = 0;
+    for (auto o : objects)
+        if (o->body != nullptr)
+            count++;
+    return count;
+}
+
+void PWorld::saveBodies(PBodyState *states) const
+{
+    for (auto o : objects)
+    {
+        if (o->body == nullptr)
+            continue;
+        memcpy(states->pos, dBodyGetPosition(o->body), sizeof(states->pos));
+        memcpy(states->q, dBodyGetQuaternion(o->body), sizeof(states->q));
+        memcpy(states->lvel, dBodyGetLinearVel(o->body), sizeof(states->lvel));
+        memcpy(states->avel, dBodyGetAngularVel(o->body), sizeof(states->avel));
+        states->enabled = dBodyIsEnabled(o->body);
+        states++;
+    }
+}
+
+void PWorld::restoreBodies(const PBodyState *states)
+{
+    for (auto o : objects)
+    {
+        if (o->body == nullptr)
+            continue;
+        dBodySetPosition(o->body, states->pos[0], states->pos[1], states->pos[2]);
+        dBodySetQuaternion(o->body, states->q);
+        dBodySetLinearVel(o->body, states->lvel[0], states->lvel[1], states->lvel[2]);
+        dBodySetAngularVel(o->body, states->avel[0], states->avel[1], states->avel[2]);
+        if (states->enabled)
+            dBodyEnable(o->body);
+        else
+            dBodyDisable(o->body);
+        states++;
+    }
+}
+
+void PWorld::addPair(dGeomID o1, dGeomID o2)
 {
-    PSurface *sur;
-    int j = sur_matrix[*((int *)(dGeomGetData(o1)))][*((int *)(dGeomGetData(o2)))];
-    if (j != -1)
+    if (dGeomIsSpace(o1) || dGeomIsSpace(o2))
     {
-        const int N = 10;
-        dContact contact[N];
-        int n = dCollide(o1, o2, N, &contact[0].geom, sizeof(dContact));
-        if (n > 0)
+        //nested spaces are only collided against what is outside them
+        dSpaceCollide2(o1, o2, this, &nearCallback);
+        return;
+    }
+    const int id1 = *((int *)(dGeomGetData(o1)));
+    const int id2 = *((int *)(dGeomGetData(o2)));
+    stats.candidate_pairs++;
+    //the collide bits already keep class pairs without a surface away, this is only a guard
+    if (sur_table[objects[id1]->cls * PClassCount + objects[id2]->cls] == -1)
+        return;
+    stats.surface_pairs++;
+    pairs.append({qMin(id1, id2), qMax(id1, id2), o1, o2});
+}
+
+void PWorld::handleCollisions(dGeomID o1, dGeomID o2)
+{
+    if (sur_table[objects[*((int *)(dGeomGetData(o1)))]->cls * PClassCount + objects[*((int *)(dGeomGetData(o2)))]->cls] == -1)
+        return;
+    dContactGeom geoms[PWORLD_MAX_CONTACTS];
+    const int n = dCollide(o1, o2, PWORLD_MAX_CONTACTS, geoms, sizeof(dContactGeom));
+    addContacts(o1, o2, geoms, n);
+}
+
+void PWorld::addContacts(dGeomID o1, dGeomID o2, const dContactGeom *geoms, int n)
+{
+    if (n <= 0)
+        return;
+    int j = sur_table[objects[*((int *)(dGeomGetData(o1)))]->cls * PClassCount + objects[*((int *)(dGeomGetData(o2)))]->cls];
+    if (j == -1)
+        return;
+    stats.contact_pairs++;
+    PSurface *sur = surfaces[j];
+    sur->contactPos[0] = geoms[0].pos[0];
+    sur->contactPos[1] = geoms[0].pos[1];
+    sur->contactPos[2] = geoms[0].pos[2];
+    sur->contactNormal[0] = geoms[0].normal[0];
+    sur->contactNormal[1] = geoms[0].normal[1];
+    sur->contactNormal[2] = geoms[0].normal[2];
+    bool flag = true;
+    if (sur->callback != nullptr)
+        flag = sur->callback(o1, o2, sur, robot_count);
+    if (flag)
+        for (int i = 0; i < n; i++)
         {
-            sur = surfaces[j];
-            sur->contactPos[0] = contact[0].geom.pos[0];
-            sur->contactPos[1] = contact[0].geom.pos[1];
-            sur->contactPos[2] = contact[0].geom.pos[2];
-            sur->contactNormal[0] = contact[0].geom.normal[0];
-            sur->contactNormal[1] = contact[0].geom.normal[1];
-            sur->contactNormal[2] = contact[0].geom.normal[2];
-            bool flag = true;
-            if (sur->callback != nullptr)
-                flag = sur->callback(o1, o2, sur, robot_count);
-            if (flag)
-                for (int i = 0; i < n; i++)
-                {
-                    contact[i].surface = sur->surface;
-                    if (sur->usefdir1)
-                    {
-                        contact[i].fdir1[0] = sur->fdir1[0];
-                        contact[i].fdir1[1] = sur->fdir1[1];
-                        contact[i].fdir1[2] = sur->fdir1[2];
-                        contact[i].fdir1[3] = sur->fdir1[3];
-                    }
-                    dJointID c = dJointCreateContact(world, contactgroup, &contact[i]);
-
-                    dJointAttach(c,
-                                 dGeomGetBody(contact[i].geom.g1),
-                                 dGeomGetBody(contact[i].geom.g2));
-                }
+            dContact contact;
+            contact.geom = geoms[i];
+            contact.surface = sur->surface;
+            if (sur->usefdir1)
+            {
+                contact.fdir1[0] = sur->fdir1[0];
+                contact.fdir1[1] = sur->fdir1[1];
+                contact.fdir1[2] = sur->fdir1[2];
+                contact.fdir1[3] = sur->fdir1[3];
+            }
+            dJointID c = dJointCreateContact(world, contactgroup, &contact);
+
+            dJointAttach(c,
+                         dGeomGetBody(contact.geom.g1),
+                         dGeomGetBody(contact.geom.g2));
         }
+}
+
+void PWorld::collidePairs()
+{
+    const int count = pairs.size();
+    if (collide_pool == nullptr || count < PWORLD_PARALLEL_MIN_PAIRS)
+    {
+        for (const auto &pair : pairs)
+            handleCollisions(pair.o1, pair.o2);
+        return;
     }
+    //dCollide only reads the geoms, so pairs are collided in parallel into their own slots;
+    //callbacks and joints then run on this thread in pair order, as they would serially
+    pair_contacts.resize(count * PWORLD_MAX_CONTACTS);
+    pair_contact_count.resize(count);
+    const PGeomPair *list = pairs.constData();
+    dContactGeom *contacts = pair_contacts.data();
+    int *counts = pair_contact_count.data();
+    const int jobs = qMin(count, collide_pool->size() * 4);
+    collide_pool->parallelFor(jobs, [&](int job) {
+        initThread();
+        const int end = (job + 1) * count / jobs;
+        for (int i = job * count / jobs; i < end; i++)
+            counts[i] = dCollide(list[i].o1, list[i].o2, PWORLD_MAX_CONTACTS,
+                                 contacts + i * PWORLD_MAX_CONTACTS, sizeof(dContactGeom));
+    });
+    for (int i = 0; i < count; i++)
+        addContacts(list[i].o1, list[i].o2, contacts + i * PWORLD_MAX_CONTACTS, counts[i]);
 }
 
-void PWorld::addObject(PObject *o)
+void PWorld::setCollideThreads(int threads)
+{
+    delete collide_pool;
+    collide_pool = threads > 1 ? new ThreadPool(threads) : nullptr;
+}
+
+void PWorld::clearContacts()
+{
+    dJointGroupEmpty(contactgroup);
+}
+
+void PWorld::addObject(PObject *o, PClass cls)
 {
     int id = objects.count();
     o->id = id;
+    o->cls = cls;
     if (o->world == nullptr)
         o->world = world;
     if (o->space == nullptr)
@@ -116,65 +319,87 @@ void PWorld::addObject(PObject *o)
     o->graphics = g;
     o->init();
     dGeomSetData(o->geom, (void *)(&(o->id)));
+    dGeomSetCategoryBits(o->geom, 1ul << cls);
+    dGeomSetCollideBits(o->geom, collide_bits[cls]);
     objects.append(o);
 }
 
 void PWorld::initAllObjects()
 {
-    objects_count = objects.count();
-    int c = objects_count;
-    bool flag = false;
-    if (sur_matrix != nullptr)
-    {
-        for (int i = 0; i < c; i++)
-            delete sur_matrix[i];
-        delete sur_matrix;
-        flag = true;
-    }
-    sur_matrix = new int *[c];
-    for (int i = 0; i < c; i++)
-    {
-        sur_matrix[i] = new int[c];
-        for (int j = 0; j < c; j++)
-            sur_matrix[i][j] = -1;
-    }
-    if (flag)
-    {
-        for (int i = 0; i < surfaces.count(); i++)
-            sur_matrix[(*(int *)(dGeomGetData(surfaces[i]->id1)))][*((int *)(dGeomGetData(surfaces[i]->id2)))] =
-                sur_matrix[(*(int *)(dGeomGetData(surfaces[i]->id2)))][*((int *)(dGeomGetData(surfaces[i]->id1)))] = i;
-    }
+    for (auto &o : objects)
+        dGeomSetCollideBits(o->geom, collide_bits[o->cls]);
+    //a nested space takes the union of its geoms' bits, so it is culled as a whole
+    for (auto &o : objects)
+        if (o->space != space)
+        {
+            dGeomSetCategoryBits((dGeomID)o->space, 0);
+            dGeomSetCollideBits((dGeomID)o->space, 0);
+        }
+    for (auto &o : objects)
+        if (o->space != space)
+        {
+            dGeomSetCategoryBits((dGeomID)o->space, dGeomGetCategoryBits((dGeomID)o->space) | (1ul << o->cls));
+            dGeomSetCollideBits((dGeomID)o->space, dGeomGetCollideBits((dGeomID)o->space) | collide_bits[o->cls]);
+        }
 }
 
-PSurface *PWorld::createSurface(PObject *o1, PObject *o2)
+PSurface *PWorld::createSurface(PClass c1, PClass c2)
 {
     auto *s = new PSurface();
-    s->id1 = o1->geom;
-    s->id2 = o2->geom;
+    s->class1 = c1;
+    s->class2 = c2;
     surfaces.append(s);
-    sur_matrix[o1->id][o2->id] =
-        sur_matrix[o2->id][o1->id] = surfaces.count() - 1;
+    sur_table[c1 * PClassCount + c2] =
+        sur_table[c2 * PClassCount + c1] = surfaces.count() - 1;
+    collide_bits[c1] |= 1ul << c2;
+    collide_bits[c2] |= 1ul << c1;
+    initAllObjects();
     return s;
 }
 
-PSurface *PWorld::findSurface(PObject *o1, PObject *o2)
+void PWorld::copySurfaces(const PWorld &source, const void *source_data, void *data)
 {
-    for (int i = 0; i < surfaces.count(); i++)
+    for (const PSurface *s : source.surfaces)
     {
-        if (surfaces[i]->isIt(o1->geom, o2->geom))
-            return (surfaces[i]);
+        PSurface *copy = createSurface(s->class1, s->class2);
+        *copy = *s;
+        if (copy->data == source_data)
+            copy->data = data;
     }
-    return nullptr;
+}
+
+PSurface *PWorld::findSurface(PObject *o1, PObject *o2)
+{
+    const int j = sur_table[o1->cls * PClassCount + o2->cls];
+    return j == -1 ? nullptr : surfaces[j];
 }
 
 void PWorld::step(dReal dt, bool sync)
 {
+    initThread();
     try
     {
-        dSpaceCollide(space, this, &nearCallback);
-        dWorldSetQuickStepNumIterations(world, 20);
+        //the space reports pairs in an order that depends on hashing, contacts are
+        //created in object id order instead so the same state always gives the same joints
+        {
+            PROFILE_SCOPE(PROFILE_COLLIDE);
+            pairs.clear();
+            if (broadphase.type == PBroadphaseGrid)
+                gridCollide();
+            else
+                dSpaceCollide(space, this, &nearCallback);
+            std::sort(pairs.begin(), pairs.end());
+            collidePairs();
+        }
+        PROFILE_SCOPE(PROFILE_SOLVE);
         if (sync)
+        {
+            //quickstep reorders constraints with ODE's process wide generator
+            std::lock_guard<std::mutex> lock(ode_rand_mutex);
+            dRandSetSeed(ode_seed);
             dWorldQuickStep(world, (dt < 0) ? delta_time : dt);
+            ode_seed = dRandGetSeed();
+        }
         else
             dWorldStep(world, (dt < 0) ? delta_time : dt);
         dJointGroupEmpty(contactgroup);
@@ -185,6 +410,170 @@ void PWorld::step(dReal dt, bool sync)
     }
 }
 
+void PWorld::gridTest(int i, int j)
+{
+    const PGridGeom &a = grid_geoms[i];
+    const PGridGeom &b = grid_geoms[j];
+    stats.aabb_tests++;
+    if (a.aabb[0] > b.aabb[1] || b.aabb[0] > a.aabb[1] ||
+        a.aabb[2] > b.aabb[3] || b.aabb[2] > a.aabb[3] ||
+        a.aabb[4] > b.aabb[5] || b.aabb[4] > a.aabb[5])
+        return;
+    //same rules as ODE's own spaces: nothing inside one body
+    const dBodyID b1 = dGeomGetBody(a.geom), b2 = dGeomGetBody(b.geom);
+    if (b1 != nullptr && b1 == b2)
+        return;
+    if (!(dGeomGetCategoryBits(a.geom) & dGeomGetCollideBits(b.geom)) &&
+        !(dGeomGetCategoryBits(b.geom) & dGeomGetCollideBits(a.geom)))
+        return;
+    addPair(a.geom, b.geom);
+}
+
+void PWorld::gridCollide()
+{
+    //every geom is binned into the cells its AABB covers; a pair is tested only in the
+    //cell holding the corner where both AABBs start, so pairs sharing cells are tested once
+    const dReal x0 = -broadphase.half_length, y0 = -broadphase.half_width;
+    const dReal inv = 1.0 / broadphase.cell;
+    const int n = dSpaceGetNumGeoms(space);
+    grid_geoms.resize(n);
+    grid_unbounded.clear();
+    grid_cells.clear();
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        PGridGeom &g = grid_geoms[count];
+        g.geom = dSpaceGetGeom(space, i);
+        if (!dGeomIsEnabled(g.geom))
+            continue;
+        dGeomGetAABB(g.geom, g.aabb);
+        count++;
+        //planes and rays have infinite or field sized boxes, so does anything that left the field
+        if (!(g.aabb[0] >= x0 && g.aabb[1] < -x0 && g.aabb[2] >= y0 && g.aabb[3] < -y0))
+        {
+            grid_unbounded.append(count - 1);
+            continue;
+        }
+        const int cx0 = static_cast<int>((g.aabb[0] - x0) * inv);
+        const int cx1 = qMin(grid_nx - 1, static_cast<int>((g.aabb[1] - x0) * inv));
+        const int cy0 = static_cast<int>((g.aabb[2] - y0) * inv);
+        const int cy1 = qMin(grid_ny - 1, static_cast<int>((g.aabb[3] - y0) * inv));
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++)
+                grid_cells.append(qMakePair(cy * grid_nx + cx, count - 1));
+    }
+    grid_geoms.resize(count);
+    std::sort(grid_cells.begin(), grid_cells.end());
+
+    for (int start = 0; start < grid_cells.size();)
+    {
+        const int cell = grid_cells[start].first;
+        int end = start + 1;
+        while (end < grid_cells.size() && grid_cells[end].first == cell)
+            end++;
+        for (int i = start; i < end; i++)
+            for (int j = i + 1; j < end; j++)
+            {
+                const PGridGeom &a = grid_geoms[grid_cells[i].second];
+                const PGridGeom &b = grid_geoms[grid_cells[j].second];
+                const int cx = static_cast<int>((qMax(a.aabb[0], b.aabb[0]) - x0) * inv);
+                const int cy = static_cast<int>((qMax(a.aabb[2], b.aabb[2]) - y0) * inv);
+                if (cy * grid_nx + cx == cell)
+                    gridTest(grid_cells[i].second, grid_cells[j].second);
+            }
+        start = end;
+    }
+    //planes, rays and anything leaving the field meet every other geom
+    for (int u = 0; u < grid_unbounded.size(); u++)
+        for (int i = 0; i < count; i++)
+        {
+            const int k = grid_unbounded[u];
+            //pairs of two unbounded geoms are visited once
+            if (i == k || (i > k && grid_unbounded.contains(i)))
+                continue;
+            gridTest(k, i);
+        }
+}
+
+void PWorld::setThreads(int threads)
+{
+    threads = qMax(1, threads);
+    if (threads == thread_count)
+        return;
+    if (threading != nullptr)
+    {
+        dThreadingImplementationShutdownProcessing(threading);
+        dThreadingFreeThreadPool(thread_pool);
+        dWorldSetStepThreadingImplementation(world, nullptr, nullptr);
+        dThreadingFreeImplementation(threading);
+        threading = nullptr;
+        thread_pool = nullptr;
+    }
+    thread_count = 1;
+    if (threads == 1)
+        return;
+    //null when ODE was built without its threading support, stepping stays on the caller
+    threading = dThreadingAllocateMultiThreadedImplementation();
+    if (threading == nullptr)
+        return;
+    thread_pool = dThreadingAllocateThreadPool(threads, 0, dAllocateFlagBasicData, nullptr);
+    if (thread_pool == nullptr)
+    {
+        dThreadingFreeImplementation(threading);
+        threading = nullptr;
+        return;
+    }
+    dThreadingThreadPoolServeMultiThreadedImplementation(thread_pool, threading);
+    dWorldSetStepIslandsProcessingMaxThreadCount(world, threads);
+    dWorldSetStepThreadingImplementation(world, dThreadingImplementationGetFunctions(threading), threading);
+    thread_count = threads;
+}
+
+int PWorld::threadCount() const
+{
+    return thread_count;
+}
+
+void PWorld::setAutoDisable(bool enabled)
+{
+    //a body sleeps after moving less than 1 cm/s and 0.05 rad/s, on average over
+    //5 samples, for 20 steps; contacts with awake bodies wake it again
+    auto_disable = enabled;
+    dWorldSetAutoDisableFlag(world, enabled ? 1 : 0);
+    dWorldSetAutoDisableLinearThreshold(world, 0.01);
+    dWorldSetAutoDisableAngularThreshold(world, 0.05);
+    dWorldSetAutoDisableAverageSamplesCount(world, 5);
+    dWorldSetAutoDisableSteps(world, 20);
+    dWorldSetAutoDisableTime(world, 0);
+    for (auto &o : objects)
+        if (o->body != nullptr)
+        {
+            dBodySetAutoDisableDefaults(o->body);
+            //bodies of switched-off robots stay disabled, they have no geoms to stand on
+            if (!enabled && !detached_spaces.contains(o->space))
+                dBodyEnable(o->body);
+        }
+}
+
+bool PWorld::autoDisable() const
+{
+    return auto_disable;
+}
+
+int PWorld::sleepingBodyCount() const
+{
+    int count = 0;
+    for (auto &o : objects)
+        if (o->body != nullptr && !dBodyIsEnabled(o->body))
+            count++;
+    return count;
+}
+
+void PWorld::setSolverIterations(int iterations)
+{
+    dWorldSetQuickStepNumIterations(world, iterations);
+}
+
 void PWorld::draw()
 {
     for (int i = 0; i < objects.count(); i++)
@@ -0,0 +1,117 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "profiler.h"
+
+static int bucketOf(int64_t ns)
+{
+    int b = 0;
+    while (ns > 0 && b < PROFILER_BUCKETS - 1)
+    {
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+Profiler::Profiler()
+{
+    reset();
+}
+
+Profiler &Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+const char *Profiler::phaseName(int phase)
+{
+    static const char *names[PROFILE_PHASE_COUNT] = {
+        "simStep", "ball forces", "collide", "solve", "robots", "render", "vision"};
+    return names[phase];
+}
+
+void Profiler::add(int phase, int64_t ns)
+{
+    //relaxed counters, worlds stepped on several threads share the histograms
+    buckets[phase][bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    counts[phase].fetch_add(1, std::memory_order_relaxed);
+    totals[phase].fetch_add(ns, std::memory_order_relaxed);
+    int64_t max = maxima[phase].load(std::memory_order_relaxed);
+    while (ns > max && !maxima[phase].compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        ;
+}
+
+void Profiler::reset()
+{
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        for (auto &bucket : buckets[p])
+            bucket.store(0, std::memory_order_relaxed);
+        counts[p].store(0, std::memory_order_relaxed);
+        totals[p].store(0, std::memory_order_relaxed);
+        maxima[p].store(0, std::memory_order_relaxed);
+    }
+}
+
+Profiler::Stats Profiler::stats(int phase) const
+{
+    Stats s{};
+    s.count = counts[phase].load(std::memory_order_relaxed);
+    if (s.count == 0)
+        return s;
+    s.mean = totals[phase].load(std::memory_order_relaxed) / 1000.0 / s.count;
+    s.max = maxima[phase].load(std::memory_order_relaxed) / 1000.0;
+    const uint64_t p50 = (s.count + 1) / 2, p99 = (s.count * 99 + 99) / 100;
+    uint64_t seen = 0;
+    for (int b = 0; b < PROFILER_BUCKETS; b++)
+    {
+        seen += buckets[phase][b].load(std::memory_order_relaxed);
+        const double upper = static_cast<double>(1ull << b) / 1000.0;
+        if (s.p50 == 0 && seen >= p50)
+            s.p50 = upper;
+        if (seen >= p99)
+        {
+            s.p99 = upper;
+            break;
+        }
+    }
+    //bounds past the slowest sample only widen the estimate
+    if (s.p50 > s.max)
+        s.p50 = s.max;
+    if (s.p99 > s.max)
+        s.p99 = s.max;
+    return s;
+}
+
+QString Profiler::report() const
+{
+    QString out = QString("%1 %2 %3 %4 %5 %6\n")
+                      .arg("phase", -12).arg("count", 10).arg("mean us", 10)
+                      .arg("p50 us", 10).arg("p99 us", 10).arg("max us", 10);
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++)
+    {
+        const Stats s = stats(p);
+        out += QString("%1 %2 %3 %4 %5 %6\n")
+                   .arg(phaseName(p), -12).arg(s.count, 10)
+                   .arg(s.mean, 10, 'f', 1).arg(s.p50, 10, 'f', 1)
+                   .arg(s.p99, 10, 'f', 1).arg(s.max, 10, 'f', 1);
+    }
+    return out;
+}
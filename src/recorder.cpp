@@ -0,0 +1,224 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "recorder.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "sslworld.h"
+#include "logger.h"
+
+#define RECORD_BATCH 256 //frames per write
+
+static void fillSettings(RecordRobotSettings &s, const RobotSettings &r)
+{
+    s.radius = r.RobotRadius;
+    s.height = r.RobotHeight;
+    s.wheel_radius = r.WheelRadius;
+    s.wheel1_angle = r.Wheel1Angle;
+    s.wheel2_angle = r.Wheel2Angle;
+    s.body_mass = r.BodyMass;
+    s.wheel_mass = r.WheelMass;
+    s.motor_fmax = r.Wheel_Motor_FMax;
+}
+
+MatchRecorder::MatchRecorder()
+{
+    next_frame = 0;
+    stopping = false;
+}
+
+MatchRecorder::~MatchRecorder()
+{
+    close();
+}
+
+bool MatchRecorder::supports(int robots_per_team)
+{
+    if (robots_per_team <= MAX_ROBOT_COUNT)
+        return true;
+    logStatus(QString("Cannot record %1 robots per team, match logs hold at most %2").arg(robots_per_team).arg(MAX_ROBOT_COUNT), QColor("red"));
+    return false;
+}
+
+bool MatchRecorder::open(const QString &fileName, SSLWorld *world)
+{
+    close();
+    if (!supports(world->cfg->Robots_Count()))
+        return false;
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        logStatus(QString("Could not open record file %1").arg(fileName), QColor("red"));
+        return false;
+    }
+    const std::string field = world->fieldGeometry().SerializeAsString();
+    RecordHeader header{};
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.version = RECORD_VERSION;
+    //frames start 64 byte aligned, so a mapped log can be read in place
+    header.header_size = (sizeof(RecordHeader) + field.size() + 63) & ~63u;
+    header.record_size = sizeof(RecordFrame);
+    header.max_robots = MAX_ROBOT_COUNT;
+    header.delta_time = world->cfg->DeltaTime();
+    header.ball_radius = world->cfg->BallRadius();
+    header.ball_mass = world->cfg->BallMass();
+    fillSettings(header.blue, world->cfg->blueSettings);
+    fillSettings(header.yellow, world->cfg->yellowSettings);
+    header.field_size = field.size();
+    QByteArray head(header.header_size, 0);
+    memcpy(head.data(), &header, sizeof(header));
+    memcpy(head.data() + sizeof(header), field.data(), field.size());
+    file.write(head);
+
+    pending.reserve(RECORD_BATCH * 2);
+    writing.reserve(RECORD_BATCH * 2);
+    stopping = false;
+    next_frame = 0;
+    thread = std::thread(&MatchRecorder::writer, this);
+    logStatus(QString("Recording to %1").arg(fileName), QColor("green"));
+    return true;
+}
+
+void MatchRecorder::close()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    file.close();
+}
+
+bool MatchRecorder::isOpen() const
+{
+    return thread.joinable();
+}
+
+void MatchRecorder::record(const RecordFrame &frame)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(frame);
+    pending.back().frame = next_frame++;
+    if (pending.size() == RECORD_BATCH)
+        wake.notify_one();
+}
+
+void MatchRecorder::writer()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        //a partial batch is flushed after a while, so a slow match still reaches the disk
+        wake.wait_for(lock, std::chrono::milliseconds(500),
+                      [&] { return stopping || pending.size() >= RECORD_BATCH; });
+        pending.swap(writing);
+        const bool stop = stopping;
+        lock.unlock();
+        if (!writing.empty())
+            file.write(reinterpret_cast<const char *>(writing.data()), writing.size() * sizeof(RecordFrame));
+        writing.clear();
+        if (stop)
+            break;
+        lock.lock();
+    }
+    file.flush();
+}
+
+MatchLog::MatchLog()
+{
+    data = nullptr;
+    size = 0;
+}
+
+MatchLog::~MatchLog()
+{
+    close();
+}
+
+bool MatchLog::open(const QString &fileName)
+{
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    size = file.size();
+    if (size < static_cast<qint64>(sizeof(RecordHeader)) || (data = file.map(0, size)) == nullptr)
+    {
+        close();
+        return false;
+    }
+    const RecordHeader *h = header();
+    if (memcmp(h->magic, RECORD_MAGIC, sizeof(h->magic)) != 0 || h->version != RECORD_VERSION ||
+        h->record_size != sizeof(RecordFrame) || h->max_robots != MAX_ROBOT_COUNT || h->header_size > size ||
+        sizeof(RecordHeader) + static_cast<qint64>(h->field_size) > h->header_size)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MatchLog::close()
+{
+    if (data != nullptr)
+        file.unmap(const_cast<uchar *>(data));
+    data = nullptr;
+    size = 0;
+    file.close();
+}
+
+const RecordHeader *MatchLog::header() const
+{
+    return reinterpret_cast<const RecordHeader *>(data);
+}
+
+bool MatchLog::field(fira_message::Field *field) const
+{
+    return field->ParseFromArray(data + sizeof(RecordHeader), header()->field_size);
+}
+
+qint64 MatchLog::frameCount() const
+{
+    if (data == nullptr)
+        return 0;
+    return (size - header()->header_size) / header()->record_size;
+}
+
+const RecordFrame *MatchLog::frameAt(qint64 index) const
+{
+    return reinterpret_cast<const RecordFrame *>(data + header()->header_size + index * header()->record_size);
+}
+
+qint64 MatchLog::offset(uint32_t frame) const
+{
+    //the recorder numbers frames consecutively from 0, so the number is the index
+    if (static_cast<qint64>(frame) >= frameCount() || frameAt(frame)->frame != frame)
+        return -1;
+    return header()->header_size + static_cast<qint64>(frame) * header()->record_size;
+}
+
+const RecordFrame *MatchLog::findFrame(uint32_t frame) const
+{
+    const qint64 o = offset(frame);
+    return o < 0 ? nullptr : reinterpret_cast<const RecordFrame *>(data + o);
+}
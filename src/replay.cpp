@@ -0,0 +1,162 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "replay.h"
+
+#include <algorithm>
+
+#define REPLAY_BURST 64 //frames per tick when not paced
+
+ReplayStreamer::ReplayStreamer(RoboCupSSLServer *server, QObject *parent)
+    : QObject(parent), server(server)
+{
+    index = clock_index = sent = 0;
+    speed = 1;
+    loop = false;
+    geometry_every = 120;
+    connect(&timer, SIGNAL(timeout()), this, SLOT(tick()));
+}
+
+bool ReplayStreamer::open(const QString &fileName)
+{
+    stop();
+    if (!log.open(fileName))
+    {
+        logStatus(QString("Could not read match log %1").arg(fileName), QColor("red"));
+        return false;
+    }
+    log.field(&field);
+    index = sent = 0;
+    logStatus(QString("Replaying %1 frames from %2").arg(log.frameCount()).arg(fileName), QColor("green"));
+    return true;
+}
+
+void ReplayStreamer::setSpeed(double s)
+{
+    speed = std::max(0.0, s);
+    if (timer.isActive())
+        start();
+}
+
+void ReplayStreamer::setLoop(bool l)
+{
+    loop = l;
+}
+
+void ReplayStreamer::setGeometryEvery(int frames)
+{
+    geometry_every = std::max(1, frames);
+}
+
+bool ReplayStreamer::seek(uint32_t frame)
+{
+    const qint64 o = log.offset(frame);
+    if (o < 0)
+        return false;
+    index = (o - log.header()->header_size) / log.header()->record_size;
+    restartClock();
+    return true;
+}
+
+void ReplayStreamer::start()
+{
+    if (log.frameCount() == 0)
+        return;
+    //paced replay ticks about once per recorded step, but catches up by wall clock
+    const int interval = speed > 0 ? static_cast<int>(log.header()->delta_time * 1000 / speed) : 0;
+    timer.start(std::max(speed > 0 ? 1 : 0, interval));
+    restartClock();
+}
+
+void ReplayStreamer::stop()
+{
+    timer.stop();
+}
+
+qint64 ReplayStreamer::position() const
+{
+    return index;
+}
+
+void ReplayStreamer::restartClock()
+{
+    clock_index = index;
+    clock.restart();
+}
+
+void ReplayStreamer::tick()
+{
+    const qint64 count = log.frameCount();
+    qint64 target = index + REPLAY_BURST;
+    if (speed > 0)
+        target = clock_index + static_cast<qint64>(clock.elapsed() / 1000.0 * speed / log.header()->delta_time) + 1;
+    while (index < target)
+    {
+        if (index >= count)
+        {
+            if (!loop)
+            {
+                stop();
+                emit finished();
+                return;
+            }
+            index = 0;
+            restartClock();
+            return;
+        }
+        sendFrame(*log.frameAt(index));
+        index++;
+    }
+}
+
+void ReplayStreamer::sendFrame(const RecordFrame &f)
+{
+    //same wire format as SSLWorld::sendVisionBuffer, with the recorded ground truth
+    packet.Clear();
+    packet.set_step(f.step);
+    packet.set_goals_blue(f.goals_blue);
+    packet.set_goals_yellow(f.goals_yellow);
+    auto *ball = packet.mutable_frame()->mutable_ball();
+    ball->set_x(f.ball[0]);
+    ball->set_y(f.ball[1]);
+    ball->set_z(f.ball[2]);
+    ball->set_vx(f.ball[3]);
+    ball->set_vy(f.ball[4]);
+    const uint32_t robots = std::min<uint32_t>(f.robots_per_team, MAX_ROBOT_COUNT);
+    for (int team = 0; team < TEAM_COUNT; team++)
+        for (uint32_t i = 0; i < robots; i++)
+        {
+            const RecordRobot &r = team == 0 ? f.blue[i] : f.yellow[i];
+            if (!r.on)
+                continue;
+            fira_message::Robot *rob = team == 0 ? packet.mutable_frame()->add_robots_blue()
+                                                 : packet.mutable_frame()->add_robots_yellow();
+            rob->set_robot_id(i);
+            rob->set_x(r.x);
+            rob->set_y(r.y);
+            rob->set_orientation(r.orientation);
+            rob->set_vx(r.vx);
+            rob->set_vy(r.vy);
+            rob->set_vorientation(r.vorientation);
+        }
+    if (sent++ % geometry_every == 0)
+        packet.mutable_field()->CopyFrom(field);
+    buffer.resize(packet.ByteSize());
+    packet.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8 *>(buffer.data()));
+    server->send(buffer);
+}
@@ -0,0 +1,91 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "rng.h"
+
+#include <cmath>
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+Rng::Rng(uint64_t seed)
+{
+    this->seed(seed);
+}
+
+void Rng::seed(uint64_t seed)
+{
+    //splitmix64 expands the seed, xoshiro must not start from an all zero state
+    for (auto &word : s)
+    {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        word = z ^ (z >> 31);
+    }
+    deviateAvailable = false;
+    storedDeviate = 0;
+}
+
+uint64_t Rng::next()
+{
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+double Rng::uniform()
+{
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double Rng::uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * uniform();
+}
+
+//polar Box-Muller, every second call returns the stored deviate
+double Rng::normal(double mu, double sigma)
+{
+    if (sigma == 0)
+        return mu;
+    if (deviateAvailable)
+    {
+        deviateAvailable = false;
+        return storedDeviate * sigma + mu;
+    }
+    double var1, var2, rsquared;
+    do
+    {
+        var1 = 2.0 * uniform() - 1.0;
+        var2 = 2.0 * uniform() - 1.0;
+        rsquared = var1 * var1 + var2 * var2;
+    } while (rsquared >= 1.0 || rsquared == 0.0);
+    const double polar = sqrt(-2.0 * log(rsquared) / rsquared);
+    storedDeviate = var1 * polar;
+    deviateAvailable = true;
+    return var2 * polar * sigma + mu;
+}
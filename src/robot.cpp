@@ -24,7 +24,7 @@ CRobot::Wheel::Wheel(CRobot *robot, int _id, dReal ang, dReal ang2, int wheeltex
 {
     id = _id;
     rob = robot;
-    dReal rad = rob->cfg->robotSettings.RobotRadius + rob->cfg->robotSettings.WheelThickness / 2.0;
+    dReal rad = rob->settings.RobotRadius + rob->settings.WheelThickness / 2.0;
     ang *= M_PI / 180.0f;
     ang2 *= M_PI / 180.0f;
     dReal x = rob->m_x;
@@ -32,14 +32,14 @@ CRobot::Wheel::Wheel(CRobot *robot, int _id, dReal ang, dReal ang2, int wheeltex
     dReal z = rob->m_z;
     dReal centerx = x + rad * cos(ang2);
     dReal centery = y + rad * sin(ang2);
-    dReal centerz = z - rob->cfg->robotSettings.RobotHeight * 0.5 - rob->cfg->robotSettings.BottomHeight + rob->cfg->robotSettings.WheelRadius;
-    cyl = new PCylinder(centerx, centery, centerz, rob->cfg->robotSettings.WheelRadius, rob->cfg->robotSettings.WheelThickness, rob->cfg->robotSettings.WheelMass, 0.9, 0.9, 0.9, wheeltexid);
+    dReal centerz = z - rob->settings.RobotHeight * 0.5 - rob->settings.BottomHeight + rob->settings.WheelRadius;
+    cyl = new PCylinder(centerx, centery, centerz, rob->settings.WheelRadius, rob->settings.WheelThickness, rob->settings.WheelMass, 0.9, 0.9, 0.9, wheeltexid);
     cyl->setRotation(-sin(ang), cos(ang), 0, M_PI * 0.5);
     cyl->setBodyRotation(-sin(ang), cos(ang), 0, M_PI * 0.5, true);    //set local rotation matrix
     cyl->setBodyPosition(centerx - x, centery - y, centerz - z, true); //set local position vector
     cyl->space = rob->space;
 
-    rob->w->addObject(cyl);
+    rob->w->addObject(cyl, PClassWheel);
 
     joint = dJointCreateHinge(rob->w->world, nullptr);
 
@@ -52,21 +52,21 @@ CRobot::Wheel::Wheel(CRobot *robot, int _id, dReal ang, dReal ang2, int wheeltex
     dJointAttach(motor, rob->chassis->body, cyl->body);
     dJointSetAMotorNumAxes(motor, 1);
     dJointSetAMotorAxis(motor, 0, 1, cos(ang), sin(ang), 0);
-    dJointSetAMotorParam(motor, dParamFMax, rob->cfg->robotSettings.Wheel_Motor_FMax);
+    dJointSetAMotorParam(motor, dParamFMax, rob->settings.Wheel_Motor_FMax);
     speed = 0;
 }
 
 void CRobot::Wheel::step()
 {
     dJointSetAMotorParam(motor, dParamVel, speed);
-    dJointSetAMotorParam(motor, dParamFMax, rob->cfg->robotSettings.Wheel_Motor_FMax);
+    dJointSetAMotorParam(motor, dParamFMax, rob->settings.Wheel_Motor_FMax);
 }
 
 CRobot::RBall::RBall(CRobot *robot, int _id, dReal ang, dReal ang2)
 {
     id = _id;
     rob = robot;
-    dReal rad = rob->cfg->robotSettings.RobotRadius - rob->cfg->robotSettings.BallRadius;
+    dReal rad = rob->settings.RobotRadius - rob->settings.BallRadius;
     ang *= M_PI / 180.0f;
     ang2 *= M_PI / 180.0f;
     dReal x = rob->m_x;
@@ -74,14 +74,14 @@ CRobot::RBall::RBall(CRobot *robot, int _id, dReal ang, dReal ang2)
     dReal z = rob->m_z;
     dReal centerx = x + rad * cos(ang2);
     dReal centery = y + rad * sin(ang2);
-    dReal centerz = z - rob->cfg->robotSettings.RobotHeight * 0.5 - rob->cfg->robotSettings.BottomHeight + rob->cfg->robotSettings.BallRadius;
-    pBall = new PBall(centerx, centery, centerz, rob->cfg->robotSettings.BallRadius, rob->cfg->robotSettings.BallMass, 1, 0, 0);
+    dReal centerz = z - rob->settings.RobotHeight * 0.5 - rob->settings.BottomHeight + rob->settings.BallRadius;
+    pBall = new PBall(centerx, centery, centerz, rob->settings.BallRadius, rob->settings.BallMass, 1, 0, 0);
     pBall->setRotation(-sin(ang), cos(ang), 0, M_PI * 0.5);
     pBall->setBodyRotation(-sin(ang), cos(ang), 0, M_PI * 0.5, true);    //set local rotation matrix
     pBall->setBodyPosition(centerx - x, centery - y, centerz - z, true); //set local position vector
     pBall->space = rob->space;
 
-    rob->w->addObject(pBall);
+    rob->w->addObject(pBall, PClassCaster);
 
     joint = dJointCreateHinge(rob->w->world, nullptr);
 
@@ -93,7 +93,7 @@ CRobot::RBall::RBall(CRobot *robot, int _id, dReal ang, dReal ang2)
     speed = 0;
 }
 
-CRobot::CRobot(PWorld *world, PBall *ball, ConfigWidget *_cfg, dReal x, dReal y, dReal z, dReal r,
+CRobot::CRobot(PWorld *world, PBall *ball, ConfigWidget *_cfg, const RobotSettings &_settings, dReal x, dReal y, dReal z, dReal r,
                dReal g, dReal b, int rob_id, int wheeltexid, int dir, bool turn_on)
 {
     m_r = r;
@@ -106,20 +106,25 @@ CRobot::CRobot(PWorld *world, PBall *ball, ConfigWidget *_cfg, dReal x, dReal y,
     m_ball = ball;
     m_dir = dir;
     cfg = _cfg;
+    settings = _settings;
     m_rob_id = rob_id;
 
-    space = w->space;
+    //the parts of a robot never collide with each other, so they share a nested space
+    //that the world space tests as one geom and nearCallback only opens against others
+    space = dSimpleSpaceCreate(w->space);
 
-    chassis = new PBox(x, y, z, cfg->robotSettings.RobotRadius * 2, cfg->robotSettings.RobotRadius * 2, cfg->robotSettings.RobotHeight, cfg->robotSettings.BodyMass, r, g, b, rob_id, true);
+    chassis = new PBox(x, y, z, settings.RobotRadius * 2, settings.RobotRadius * 2, settings.RobotHeight, settings.BodyMass, r, g, b, rob_id, true);
     chassis->space = space;
-    w->addObject(chassis);
+    w->addObject(chassis, PClassChassis);
 
-    wheels[0] = new Wheel(this, 0, cfg->robotSettings.Wheel1Angle, cfg->robotSettings.Wheel1Angle, wheeltexid);
-    wheels[1] = new Wheel(this, 1, cfg->robotSettings.Wheel2Angle, cfg->robotSettings.Wheel2Angle, wheeltexid);
-    balls[0] = new RBall(this, 0, cfg->robotSettings.Wheel1Angle + 90, cfg->robotSettings.Wheel1Angle + 90);
-    balls[1] = new RBall(this, 1, cfg->robotSettings.Wheel2Angle + 90, cfg->robotSettings.Wheel2Angle + 90);
+    wheels[0] = new Wheel(this, 0, settings.Wheel1Angle, settings.Wheel1Angle, wheeltexid);
+    wheels[1] = new Wheel(this, 1, settings.Wheel2Angle, settings.Wheel2Angle, wheeltexid);
+    balls[0] = new RBall(this, 0, settings.Wheel1Angle + 90, settings.Wheel1Angle + 90);
+    balls[1] = new RBall(this, 1, settings.Wheel2Angle + 90, settings.Wheel2Angle + 90);
     firsttime = true;
-    on = turn_on;
+    on = true;
+    attached = true;
+    setOn(turn_on);
 }
 
 CRobot::~CRobot() = default;
@@ -149,6 +154,14 @@ void normalizeVector(dReal &x, dReal &y, dReal &z)
 
 void CRobot::step()
 {
+    //anything that wrote on directly (restoreState, older callers) is caught up here
+    if (on != attached)
+        setOn(on);
+    if (!attached)
+    {
+        last_state = on;
+        return;
+    }
     if (on)
     {
         if (firsttime)
@@ -163,13 +176,70 @@ void CRobot::step()
         if (last_state)
             wheels[0]->speed = wheels[1]->speed = 0;
     }
+    //a driven robot never sleeps, even when pushing against something that stops it
+    if (wheels[0]->speed != 0 || wheels[1]->speed != 0)
+        wake();
     for (auto &wheel : wheels)
         wheel->step();
     last_state = on;
 }
 
+void CRobot::wake()
+{
+    if (attached)
+        setBodiesEnabled(true);
+}
+
+void CRobot::setBodiesEnabled(bool enabled)
+{
+    void (*set)(dBodyID) = enabled ? dBodyEnable : dBodyDisable;
+    set(chassis->body);
+    for (auto &wheel : wheels)
+        set(wheel->cyl->body);
+    for (auto &b : balls)
+        set(b->pBall->body);
+}
+
+void CRobot::setOn(bool turn_on)
+{
+    on = turn_on;
+    if (turn_on == attached)
+        return;
+    //a robot that is off leaves the world entirely: its nested space is taken out of
+    //the world space and its bodies and joints are disabled, so it costs nothing per step
+    void (*set)(dJointID) = turn_on ? dJointEnable : dJointDisable;
+    for (auto &wheel : wheels)
+    {
+        set(wheel->joint);
+        set(wheel->motor);
+    }
+    for (auto &b : balls)
+        set(b->joint);
+    if (turn_on)
+        w->attachSpace(space);
+    else
+        w->detachSpace(space);
+    //either way the robot starts at rest, nothing it picked up while detached comes back with it
+    resetSpeeds();
+    dBodySetLinearVel(chassis->body, 0, 0, 0);
+    dBodySetAngularVel(chassis->body, 0, 0, 0);
+    for (auto &wheel : wheels)
+    {
+        dBodySetLinearVel(wheel->cyl->body, 0, 0, 0);
+        dBodySetAngularVel(wheel->cyl->body, 0, 0, 0);
+    }
+    for (auto &b : balls)
+    {
+        dBodySetLinearVel(b->pBall->body, 0, 0, 0);
+        dBodySetAngularVel(b->pBall->body, 0, 0, 0);
+    }
+    attached = turn_on;
+    setBodiesEnabled(turn_on);
+}
+
 void CRobot::drawLabel()
 {
+#ifndef FIRASIM_HEADLESS
     glPushMatrix();
     dVector3 pos;
     dReal fr_r, fr_b, fr_n;
@@ -192,7 +262,7 @@ void CRobot::drawLabel()
     normalizeVector(rx, ry, rz);
     dReal zz = fx * ax + fy * ay + fz * az;
     dReal zfact = zz / fr_n;
-    pos[2] += cfg->robotSettings.RobotHeight * 0.5f + cfg->robotSettings.BottomHeight + cfg->robotSettings.WheelRadius + txtHeight * zfact;
+    pos[2] += settings.RobotHeight * 0.5f + settings.BottomHeight + settings.WheelRadius + txtHeight * zfact;
     dMatrix3 rot;
     dRFromAxisAndAngle(rot, 0, 0, 0, 0);
     dReal tx = fy * rz - ry * fz;
@@ -217,6 +287,7 @@ void CRobot::drawLabel()
     glDisable(GL_BLEND);
     w->g->noTexture();
     glPopMatrix();
+#endif
 }
 
 void CRobot::resetSpeeds()
@@ -274,7 +345,7 @@ dReal CRobot::getDir(dReal &k)
 void CRobot::setXY(dReal x, dReal y)
 {
     dReal xx, yy, zz, kx, ky, kz;
-    dReal height = ROBOT_START_Z(cfg);
+    dReal height = ROBOT_START_Z(settings);
     chassis->getBodyPosition(xx, yy, zz);
     chassis->setBodyPosition(x, y, height);
     for (auto &wheel : wheels)
@@ -282,6 +353,9 @@ void CRobot::setXY(dReal x, dReal y)
         wheel->cyl->getBodyPosition(kx, ky, kz);
         wheel->cyl->setBodyPosition(kx - xx + x, ky - yy + y, kz - zz + height);
     }
+    //moving a body enables it, a robot that is off has no geoms to stand on
+    if (!attached)
+        setBodiesEnabled(false);
 }
 
 void CRobot::setDir(dReal ang)
@@ -308,6 +382,8 @@ void CRobot::setDir(dReal ang)
         finalPos[2] += cPos[2];
         wheel->cyl->setBodyPosition(finalPos[0], finalPos[1], finalPos[2], false);
     }
+    if (!attached)
+        setBodiesEnabled(false);
 }
 
 void CRobot::setSpeed(int i, dReal s)
@@ -319,8 +395,8 @@ void CRobot::setSpeed(int i, dReal s)
 void CRobot::setSpeed(dReal vx, dReal vy, dReal vw)
 {
     // Calculate Motor Speeds
-    dReal dw1 = (1.0 / cfg->robotSettings.WheelRadius) * ((cfg->robotSettings.RobotRadius * vw) + vx);
-    dReal dw2 = (1.0 / cfg->robotSettings.WheelRadius) * ((cfg->robotSettings.RobotRadius * -vw) + vx);
+    dReal dw1 = (1.0 / settings.WheelRadius) * ((settings.RobotRadius * vw) + vx);
+    dReal dw2 = (1.0 / settings.WheelRadius) * ((settings.RobotRadius * -vw) + vx);
 
     setSpeed(0, dw1);
     setSpeed(1, dw2);
@@ -338,3 +414,27 @@ void CRobot::incSpeed(int i, dReal v)
     if (!((i >= 2) || (i < 0)))
         wheels[i]->speed += v;
 }
+
+void CRobot::saveState(State &s) const
+{
+    for (int i = 0; i < 2; i++)
+    {
+        s.speed[i] = wheels[i]->speed;
+        s.motor_vel[i] = dJointGetAMotorParam(wheels[i]->motor, dParamVel);
+    }
+    s.on = on;
+    s.last_state = last_state;
+    s.firsttime = firsttime;
+}
+
+void CRobot::restoreState(const State &s)
+{
+    setOn(s.on);
+    for (int i = 0; i < 2; i++)
+    {
+        wheels[i]->speed = s.speed[i];
+        dJointSetAMotorParam(wheels[i]->motor, dParamVel, s.motor_vel[i]);
+    }
+    last_state = s.last_state;
+    firsttime = s.firsttime;
+}
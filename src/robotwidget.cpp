@@ -34,12 +34,7 @@ RobotWidget::RobotWidget(QWidget* parent, ConfigWidget* cfg)
     teamCombo->addItem("Blue");
     teamCombo->addItem("Yellow");
     robotCombo = new QComboBox(this);
-
-    // Add items to the combo box dynamically 
-    for (int i=0; i<MAX_ROBOT_COUNT; i++){
-      QString item=QString::number(i);
-      robotCombo->addItem(item);
-    }
+    setRobotCount(cfg->Robots_Count());
 
     vellabel = new QLabel;
     acclabel = new QLabel;
@@ -71,6 +66,22 @@ void RobotWidget::setPicture(QImage* img)
     robotpic->setPixmap(QPixmap::fromImage(*img).scaled(128, 128, Qt::IgnoreAspectRatio, Qt::FastTransformation));
 }
 
+void RobotWidget::setRobotCount(int count)
+{
+    // Add items to the combo box dynamically, keeping the selection if it still exists
+    // only robots with their own texture can be picked
+    count = qMin(count, MAX_ROBOT_COUNT);
+    const int current = robotCombo->currentIndex();
+    robotCombo->blockSignals(true);
+    robotCombo->clear();
+    for (int i=0; i<count; i++){
+      QString item=QString::number(i);
+      robotCombo->addItem(item);
+    }
+    robotCombo->setCurrentIndex(current >= 0 && current < count ? current : 0);
+    robotCombo->blockSignals(false);
+}
+
 void RobotWidget::changeRobotOnOff(int _id,bool a)
 {
     if (_id==id) {
@@ -0,0 +1,107 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simthread.h"
+
+#include <QElapsedTimer>
+
+#include "sslworld.h"
+
+SimThread::SimThread(ConfigWidget *_cfg, QObject *parent)
+    : QThread(parent)
+{
+    cfg = _cfg;
+    world = nullptr;
+    stopping = false;
+    rate = 0;
+}
+
+SimThread::~SimThread()
+{
+    stopStepping();
+}
+
+void SimThread::setWorld(SSLWorld *w)
+{
+    //only while stopped, the thread never sees the pointer change
+    world = w;
+}
+
+void SimThread::startStepping()
+{
+    if (world == nullptr || isRunning()) return;
+    stopping = false;
+    world->freeRunning = true;
+    start();
+}
+
+void SimThread::stopStepping()
+{
+    if (!isRunning()) return;
+    stopping = true;
+    wait();
+    world->freeRunning = false;
+    rate = 0;
+}
+
+double SimThread::stepRate() const
+{
+    return rate;
+}
+
+void SimThread::run()
+{
+    QElapsedTimer clock, rate_clock;
+    clock.start();
+    rate_clock.start();
+    double sim_time = 0;
+    int steps = 0;
+    while (!stopping)
+    {
+        if (world->lockStep)
+        {
+            msleep(1);
+            clock.restart();
+            sim_time = 0;
+            continue;
+        }
+        const dReal dt = cfg->DeltaTime();
+        world->advance(dt);
+        steps++;
+        if (rate_clock.elapsed() >= 1000)
+        {
+            rate = steps * 1e9 / rate_clock.nsecsElapsed();
+            rate_clock.restart();
+            steps = 0;
+        }
+        const double rtf = cfg->RealTimeFactor();
+        if (rtf <= 0)
+            continue;
+        sim_time += dt;
+        const qint64 due = static_cast<qint64>(sim_time / rtf * 1e9);
+        const qint64 now = clock.nsecsElapsed();
+        if (due > now)
+            usleep(static_cast<unsigned long>((due - now) / 1000));
+        else if (now - due > 100000000)
+        {
+            //fell behind by more than 100ms (e.g. a stall), do not try to catch up
+            clock.restart();
+            sim_time = 0;
+        }
+    }
+}
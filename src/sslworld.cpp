@@ -20,13 +20,20 @@ Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
 
 #include <QtGlobal>
 #include <QtNetwork>
+#include <QThread>
 
 #include <QDebug>
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <random>
 #include <math.h>
+#include <memory>
 
 #include "logger.h"
+#include "profiler.h"
 
 #include "command.pb.h"
 #include "packet.pb.h"
@@ -37,10 +44,61 @@ using namespace fira_message::sim_to_ref;
 
 #define WHEEL_COUNT 2
 
-SSLWorld *_w;
-dReal randn_notrig(dReal mu = 0.0, dReal sigma = 1.0);
-dReal randn_trig(dReal mu = 0.0, dReal sigma = 1.0);
-dReal rand0_1();
+dReal normalizeAngle(dReal a);
+
+#define STATE_MAGIC 0x46535354u //"FSST"
+#define STATE_VERSION 2
+
+#define SPOT_SPACING 0.11 //grid step of the spots given to robots past the preset tables, m
+
+//saveState() blob: this header, one PBodyState per body, one WorldRobotState per robot,
+//then every queued vision frame as {int32 t, int32 size, bytes}
+struct WorldStateHeader
+{
+    uint32_t magic, version;
+    int32_t body_count, robot_count, send_count;
+    int32_t steps_super, steps_fault, frame_num, minute;
+    int32_t goals_blue, goals_yellow, ball_tag;
+    uint8_t received, geometry_pending;
+    dReal last_dt;
+    float ball_prev_x, ball_prev_y;
+    uint64_t rng[4];
+    double rng_deviate;
+    uint32_t rng_deviate_available;
+    uint64_t ode_seed;
+};
+
+struct WorldRobotState
+{
+    CRobot::State robot;
+    int32_t kick;
+    uint8_t infrared;
+};
+
+//first spot of a grid over the field that keeps clear of every taken position,
+//robots only land outside the field once the grid is full. A mirrored spot is used
+//as (-x, y) for one team and (x, y) for the other, so both images must be clear
+static void freeSpot(const std::vector<std::pair<dReal, dReal>> &taken, dReal &x, dReal &y, bool mirrored = false)
+{
+    auto clearOf = [&taken](dReal cx, dReal cy) {
+        for (const auto &t : taken)
+            if (fabs(t.first - cx) < SPOT_SPACING && fabs(t.second - cy) < SPOT_SPACING)
+                return false;
+        return true;
+    };
+    for (int row = 0; -0.55 + row * SPOT_SPACING <= 0.55; row++)
+        for (int col = 0; -0.65 + col * SPOT_SPACING <= 0.65; col++)
+        {
+            x = -0.65 + col * SPOT_SPACING;
+            y = -0.55 + row * SPOT_SPACING;
+            if (mirrored && fabs(2 * x) < SPOT_SPACING)
+                continue;
+            if (clearOf(x, y) && (!mirrored || clearOf(-x, y)))
+                return;
+        }
+    x = 0.4 * (taken.size() + 1);
+    y = -3.4;
+}
 
 dReal fric(dReal f)
 {
@@ -51,19 +109,12 @@ dReal fric(dReal f)
 
 bool wheelCallBack(dGeomID o1, dGeomID o2, PSurface *s, int /*robots_count*/)
 {
-    //s->id2 is ground
+    //the surface is shared by every wheel, the ground is the geom without a body
     const dReal *r; //wheels rotation matrix
-    //const dReal* p; //wheels rotation matrix
-    if ((o1 == s->id1) && (o2 == s->id2))
-    {
+    if (dGeomGetBody(o1) != nullptr && dGeomGetBody(o2) == nullptr)
         r = dBodyGetRotation(dGeomGetBody(o1));
-        //p=dGeomGetPosition(o1);//never read
-    }
-    else if ((o1 == s->id2) && (o2 == s->id1))
-    {
+    else if (dGeomGetBody(o2) != nullptr && dGeomGetBody(o1) == nullptr)
         r = dBodyGetRotation(dGeomGetBody(o2));
-        //p=dGeomGetPosition(o2);//never read
-    }
     else
     {
         //XXX: in this case we dont have the rotation
@@ -71,9 +122,10 @@ bool wheelCallBack(dGeomID o1, dGeomID o2, PSurface *s, int /*robots_count*/)
         return false;
     }
 
+    auto *w = (SSLWorld *)s->data;
     s->surface.mode = dContactFDir1 | dContactMu2 | dContactApprox1 | dContactSoftCFM;
-    s->surface.mu = fric(_w->cfg->robotSettings.WheelPerpendicularFriction);
-    s->surface.mu2 = fric(_w->cfg->robotSettings.WheelTangentFriction);
+    s->surface.mu = fric(w->robotSettings.WheelPerpendicularFriction);
+    s->surface.mu2 = fric(w->robotSettings.WheelTangentFriction);
     s->surface.soft_cfm = 0.002;
 
     dVector3 v = {0, 0, 1, 1};
@@ -90,77 +142,84 @@ bool wheelCallBack(dGeomID o1, dGeomID o2, PSurface *s, int /*robots_count*/)
 
 bool rayCallback(dGeomID o1, dGeomID o2, PSurface *s, int robots_count)
 {
-    if (!_w->updatedCursor)
+    auto *w = (SSLWorld *)s->data;
+    if (!w->updatedCursor)
         return false;
     dGeomID obj;
-    if (o1 == _w->ray->geom)
+    if (o1 == w->ray->geom)
         obj = o2;
     else
         obj = o1;
     for (int i = 0; i < robots_count * 2; i++)
     {
-        if (_w->robots[i]->chassis->geom == obj)
+        if (w->robots[i]->chassis->geom == obj)
         {
-            _w->robots[i]->selected = true;
-            _w->robots[i]->select_x = s->contactPos[0];
-            _w->robots[i]->select_y = s->contactPos[1];
-            _w->robots[i]->select_z = s->contactPos[2];
+            w->robots[i]->selected = true;
+            w->robots[i]->select_x = s->contactPos[0];
+            w->robots[i]->select_y = s->contactPos[1];
+            w->robots[i]->select_z = s->contactPos[2];
         }
     }
-    if (_w->ball->geom == obj)
+    if (w->ball->geom == obj)
     {
-        _w->selected = -2;
+        w->selected = -2;
     }
-    if (obj == _w->ground->geom)
+    if (obj == w->ground->geom)
     {
-        _w->cursor_x = s->contactPos[0];
-        _w->cursor_y = s->contactPos[1];
-        _w->cursor_z = s->contactPos[2];
+        w->cursor_x = s->contactPos[0];
+        w->cursor_y = s->contactPos[1];
+        w->cursor_z = s->contactPos[2];
     }
     return false;
 }
 
 bool ballCallBack(dGeomID o1, dGeomID o2, PSurface *s, int /*robots_count*/)
 {
-    if (_w->ball->tag != -1) //spinner adjusting
+    auto *w = (SSLWorld *)s->data;
+    if (w->ball->tag != -1) //spinner adjusting
     {
         dReal x, y, z;
-        _w->robots[_w->ball->tag]->chassis->getBodyDirection(x, y, z);
+        w->robots[w->ball->tag]->chassis->getBodyDirection(x, y, z);
         s->fdir1[0] = x;
         s->fdir1[1] = y;
         s->fdir1[2] = 0;
         s->fdir1[3] = 0;
         s->usefdir1 = true;
         s->surface.mode = dContactMu2 | dContactFDir1 | dContactSoftCFM;
-        s->surface.mu = _w->cfg->BallFriction();
+        s->surface.mu = w->cfg->BallFriction();
         s->surface.mu2 = 0.5;
         s->surface.soft_cfm = 0.002;
     }
     return true;
 }
 
-SSLWorld::SSLWorld(QGLWidget *parent, ConfigWidget *_cfg, RobotsFormation *form)
-    : QObject(parent)
+//geometry of the field, its walls and the robots as the config describes it
+static std::shared_ptr<const SSLWorldLayout> makeLayout(ConfigWidget *cfg)
 {
-    steps_super = 0;
-    steps_fault = 0;
-    isGLEnabled = true;
-    customDT = -1;
-    _w = this;
-    cfg = _cfg;
-    m_parent = parent;
-    show3DCursor = false;
-    updatedCursor = false;
-    frame_num = 0;
-    last_dt = -1;
-    g = new CGraphics(parent);
-    g->setSphereQuality(1);
-    g->setViewpoint(0, -(cfg->Field_Width() + cfg->Field_Margin() * 2.0f) / 2.0f, 3, 90, -45, 0);
-    p = new PWorld(0.05, 9.81f, g, cfg->Robots_Count());
-    ball = new PBall(0, 0, 0.5, cfg->BallRadius(), cfg->BallMass(), 1, 0.7, 0);
-
-    ground = new PGround(cfg->Field_Rad(), cfg->Field_Length(), cfg->Field_Width(), cfg->Field_Penalty_Depth(), cfg->Field_Penalty_Width(), cfg->Field_Penalty_Point(), cfg->Field_Line_Width(), 0);
-    ray = new PRay(50);
+    auto l = std::make_shared<SSLWorldLayout>();
+    l->robot_count = cfg->Robots_Count();
+    l->robot_settings = cfg->blueSettings;
+    l->ball_radius = cfg->BallRadius();
+    l->ball_mass = cfg->BallMass();
+    l->field_rad = cfg->Field_Rad();
+    l->field_length = cfg->Field_Length();
+    l->field_width = cfg->Field_Width();
+    l->penalty_depth = cfg->Field_Penalty_Depth();
+    l->penalty_width = cfg->Field_Penalty_Width();
+    l->penalty_point = cfg->Field_Penalty_Point();
+    l->line_width = cfg->Field_Line_Width();
+
+    //the broadphase only has to cover the field, the goals and the walls around them
+    const std::string broadphase = cfg->Broadphase();
+    if (broadphase == "sap")
+        l->broadphase.type = PBroadphaseSAP;
+    else if (broadphase == "quadtree")
+        l->broadphase.type = PBroadphaseQuadTree;
+    else if (broadphase == "grid")
+        l->broadphase.type = PBroadphaseGrid;
+    l->broadphase.half_length = cfg->Field_Length() / 2.0 + cfg->Goal_Depth() + cfg->Wall_Thickness();
+    l->broadphase.half_width = cfg->Field_Width() / 2.0 + cfg->Field_Margin() + cfg->Wall_Thickness();
+    l->broadphase.cell = std::max(0.1, 4 * std::max(cfg->blueSettings.RobotRadius, cfg->yellowSettings.RobotRadius));
 
     const double thick = cfg->Wall_Thickness();
     const double increment = thick / 2; //cfg->Field_Margin() + cfg->Field_Referee_Margin() + thick / 2;
@@ -181,129 +240,105 @@ SSLWorld::SSLWorld(QGLWidget *parent, ConfigWidget *_cfg, RobotsFormation *form)
     const double gsiz_z = siz_z; //cfg->Goal_Height();
     const double gpos2_x = (cfg->Field_Length() + gsiz_x) / 2.0;
 
-    // Bounding walls
+    SSLWorldLayout::Box *walls = l->walls;
 
-    for (auto &w : walls)
-        w = new PFixedBox(thick / 2, pos_y, pos_z,
-                          siz_x, thick, siz_z,
-                          tone, tone, tone);
+    // Bounding walls
 
-    walls[0] = new PFixedBox(thick / 2, pos_y, pos_z,
-                             siz_x, thick, siz_z,
-                             tone, tone, tone);
+    walls[0] = {thick / 2, pos_y, pos_z,
+                siz_x, thick, siz_z,
+                tone, tone, tone, 0};
 
-    walls[1] = new PFixedBox(-thick / 2, -pos_y, pos_z,
-                             siz_x, thick, siz_z,
-                             tone, tone, tone);
+    walls[1] = {-thick / 2, -pos_y, pos_z,
+                siz_x, thick, siz_z,
+                tone, tone, tone, 0};
 
-    walls[2] = new PFixedBox(pos_x, gpos_y + (siz_y - gsiz_y) / 4, pos_z,
-                             thick, (siz_y - gsiz_y) / 2, siz_z,
-                             tone, tone, tone);
+    walls[2] = {pos_x, gpos_y + (siz_y - gsiz_y) / 4, pos_z,
+                thick, (siz_y - gsiz_y) / 2, siz_z,
+                tone, tone, tone, 0};
 
-    walls[10] = new PFixedBox(pos_x, -gpos_y - (siz_y - gsiz_y) / 4, pos_z,
-                              thick, (siz_y - gsiz_y) / 2, siz_z,
-                              tone, tone, tone);
+    walls[10] = {pos_x, -gpos_y - (siz_y - gsiz_y) / 4, pos_z,
+                 thick, (siz_y - gsiz_y) / 2, siz_z,
+                 tone, tone, tone, 0};
 
-    walls[3] = new PFixedBox(-pos_x, gpos_y + (siz_y - gsiz_y) / 4, pos_z,
-                             thick, (siz_y - gsiz_y) / 2, siz_z,
-                             tone, tone, tone);
+    walls[3] = {-pos_x, gpos_y + (siz_y - gsiz_y) / 4, pos_z,
+                thick, (siz_y - gsiz_y) / 2, siz_z,
+                tone, tone, tone, 0};
 
-    walls[11] = new PFixedBox(-pos_x, -gpos_y - (siz_y - gsiz_y) / 4, pos_z,
-                              thick, (siz_y - gsiz_y) / 2, siz_z,
-                              tone, tone, tone);
+    walls[11] = {-pos_x, -gpos_y - (siz_y - gsiz_y) / 4, pos_z,
+                 thick, (siz_y - gsiz_y) / 2, siz_z,
+                 tone, tone, tone, 0};
 
     // Goal walls
-    walls[4] = new PFixedBox(gpos_x, 0.0, gpos_z,
-                             gthick, gsiz_y, gsiz_z,
-                             1, 1, 0);
+    walls[4] = {gpos_x, 0.0, gpos_z,
+                gthick, gsiz_y, gsiz_z,
+                1, 1, 0, 0};
 
-    walls[5] = new PFixedBox(gpos2_x, -gpos_y, gpos_z,
-                             gsiz_x, gthick, gsiz_z,
-                             1, 1, 0);
+    walls[5] = {gpos2_x, -gpos_y, gpos_z,
+                gsiz_x, gthick, gsiz_z,
+                1, 1, 0, 0};
 
-    walls[6] = new PFixedBox(gpos2_x, gpos_y, gpos_z,
-                             gsiz_x, gthick, gsiz_z,
-                             1, 1, 0);
+    walls[6] = {gpos2_x, gpos_y, gpos_z,
+                gsiz_x, gthick, gsiz_z,
+                1, 1, 0, 0};
 
-    walls[7] = new PFixedBox(-gpos_x, 0.0, gpos_z,
-                             gthick, gsiz_y, gsiz_z,
-                             0, 0, 1);
+    walls[7] = {-gpos_x, 0.0, gpos_z,
+                gthick, gsiz_y, gsiz_z,
+                0, 0, 1, 0};
 
-    walls[8] = new PFixedBox(-gpos2_x, -gpos_y, gpos_z,
-                             gsiz_x, gthick, gsiz_z,
-                             0, 0, 1);
+    walls[8] = {-gpos2_x, -gpos_y, gpos_z,
+                gsiz_x, gthick, gsiz_z,
+                0, 0, 1, 0};
 
-    walls[9] = new PFixedBox(-gpos2_x, gpos_y, gpos_z,
-                             gsiz_x, gthick, gsiz_z,
-                             0, 0, 1);
+    walls[9] = {-gpos2_x, gpos_y, gpos_z,
+                gsiz_x, gthick, gsiz_z,
+                0, 0, 1, 0};
 
     // Corner Wall
-    walls[12] = new PFixedBox(-pos_x + gsiz_x / 2.8, pos_y - gsiz_x / 2.8, pos_z,
-                              gsiz_x, gthick, gsiz_z,
-                              tone, tone, tone);
-    walls[12]->setRotation(0, 0, 1, M_PI / 4);
-
-    walls[13] = new PFixedBox(pos_x - gsiz_x / 2.8, pos_y - gsiz_x / 2.8, pos_z,
-                              gsiz_x, gthick, gsiz_z,
-                              tone, tone, tone);
-    walls[13]->setRotation(0, 0, 1, -M_PI / 4);
-
-    walls[14] = new PFixedBox(pos_x - gsiz_x / 2.8, -pos_y + gsiz_x / 2.8, pos_z,
-                              gsiz_x, gthick, gsiz_z,
-                              tone, tone, tone);
-    walls[14]->setRotation(0, 0, 1, M_PI / 4);
-
-    walls[15] = new PFixedBox(-pos_x + gsiz_x / 2.8, -pos_y + gsiz_x / 2.8, pos_z,
-                              gsiz_x, gthick, gsiz_z,
-                              tone, tone, tone);
-    walls[15]->setRotation(0, 0, 1, -M_PI / 4);
-
-    p->addObject(ground);
-    p->addObject(ball);
-    p->addObject(ray);
-    for (auto &wall : walls)
-        p->addObject(wall);
-    const int wheeltexid = 4 * cfg->Robots_Count() + 12 + 1; //37 for 6 robots
-    srand(static_cast<unsigned>(time(0)));
-
-    cfg->robotSettings = cfg->blueSettings;
-    for (int k = 0; k < cfg->Robots_Count() * 2; k++)
-    {
-        bool turn_on = (k % cfg->Robots_Count() < 5) ? true : false;
-        float LO_X = -0.65;
-        float LO_Y = -0.55;
-        float HI_X = 0.65;
-        float HI_Y = 0.55;
-        float dir = 1.0;
-        // if (k > cfg->Robots_Count())
-        // {
-        //     cfg->robotSettings = cfg->yellowSettings;
-        //     x = form->x[k - cfg->Robots_Count()];
-        //     y = -form->y[k - cfg->Robots_Count()];
-        //     dir = -1;
-        // }
-        float x = LO_X + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / (HI_X - LO_X)));
-        float y = LO_Y + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / (HI_Y - LO_Y)));
-        x = (k % cfg->Robots_Count() < 5) ? x : 3.0;
-        y = (k % cfg->Robots_Count() < 5) ? y : 3.0;
-        robots[k] = new CRobot(
-            p, ball, cfg,
-            form->x[k], form->y[k], ROBOT_START_Z(cfg),
-            ROBOT_GRAY, ROBOT_GRAY, ROBOT_GRAY,
-            k + 1, wheeltexid, dir, turn_on);
-    }
-    
+    walls[12] = {-pos_x + gsiz_x / 2.8, pos_y - gsiz_x / 2.8, pos_z,
+                 gsiz_x, gthick, gsiz_z,
+                 tone, tone, tone, M_PI / 4};
+
+    walls[13] = {pos_x - gsiz_x / 2.8, pos_y - gsiz_x / 2.8, pos_z,
+                 gsiz_x, gthick, gsiz_z,
+                 tone, tone, tone, -M_PI / 4};
+
+    walls[14] = {pos_x - gsiz_x / 2.8, -pos_y + gsiz_x / 2.8, pos_z,
+                 gsiz_x, gthick, gsiz_z,
+                 tone, tone, tone, M_PI / 4};
+
+    walls[15] = {-pos_x + gsiz_x / 2.8, -pos_y + gsiz_x / 2.8, pos_z,
+                 gsiz_x, gthick, gsiz_z,
+                 tone, tone, tone, -M_PI / 4};
+    return l;
+}
 
-    p->initAllObjects();
+SSLWorld::SSLWorld(QGLWidget *parent, ConfigWidget *_cfg, RobotsFormation *form)
+#ifdef FIRASIM_HEADLESS
+    : QObject(nullptr)
+#else
+    : QObject(parent)
+#endif
+{
+    cfg = _cfg;
+    formation = form;
+    formation->fit();
+    m_parent = parent;
+    layout = makeLayout(cfg);
+    build(formation->x, formation->y);
+    g->setViewpoint(0, -(cfg->Field_Width() + cfg->Field_Margin() * 2.0f) / 2.0f, 3, 90, -45, 0);
 
     //Surfaces
 
-    p->createSurface(ray, ground)->callback = rayCallback;
-    p->createSurface(ray, ball)->callback = rayCallback;
-    for (int k = 0; k < cfg->Robots_Count() * 2; k++)
-    {
-        p->createSurface(ray, robots[k]->chassis)->callback = rayCallback;
-    }
+    //one surface per class pair, shared by every object of those classes
+    PSurface *ray_ground = p->createSurface(PClassRay, PClassGround);
+    ray_ground->callback = rayCallback;
+    ray_ground->data = this;
+    PSurface *ray_ball = p->createSurface(PClassRay, PClassBall);
+    ray_ball->callback = rayCallback;
+    ray_ball->data = this;
+    PSurface *ray_robot = p->createSurface(PClassRay, PClassChassis);
+    ray_robot->callback = rayCallback;
+    ray_robot->data = this;
     PSurface ballwithwall;
     ballwithwall.surface.mode = dContactBounce | dContactApprox1; // | dContactSlip1;
     ballwithwall.surface.mu = 1;                                  //fric(cfg->ballfriction());
@@ -312,61 +347,128 @@ SSLWorld::SSLWorld(QGLWidget *parent, ConfigWidget *_cfg, RobotsFormation *form)
     ballwithwall.surface.slip1 = 0; //cfg->ballslip();
 
     PSurface wheelswithground;
-    PSurface *ball_ground = p->createSurface(ball, ground);
+    PSurface *ball_ground = p->createSurface(PClassBall, PClassGround);
     ball_ground->surface = ballwithwall.surface;
     ball_ground->callback = ballCallBack;
+    ball_ground->data = this;
+
+    p->createSurface(PClassBall, PClassWall)->surface = ballwithwall.surface;
+
+    p->createSurface(PClassChassis, PClassGround);
+    p->createSurface(PClassChassis, PClassWall);
+    p->createSurface(PClassChassis, PClassBall);
+    p->createSurface(PClassWheel, PClassBall);
+    PSurface *w_g = p->createSurface(PClassWheel, PClassGround);
+    w_g->surface = wheelswithground.surface;
+    w_g->usefdir1 = true;
+    w_g->callback = wheelCallBack;
+    w_g->data = this;
+    //p->createSurface(PClassCaster, PClassBall);
+    PSurface *c_g = p->createSurface(PClassCaster, PClassGround);
+    c_g->surface = wheelswithground.surface;
+    c_g->usefdir1 = true;
+    c_g->callback = wheelCallBack;
+    c_g->data = this;
+    //parts of one robot share a body or have no surface between their classes, so only other robots' chassis collide
+    p->createSurface(PClassChassis, PClassChassis); //seams ode doesn't understand cylinder-cylinder contacts, so I used spheres
+
+    updateFieldGeometry();
+}
 
+SSLWorld::SSLWorld(const SSLWorld *source)
+    : QObject(nullptr)
+{
+    //built from the source's layout, surfaces and field message, cfg and the formation are left alone
+    cfg = source->cfg;
+    formation = source->formation;
+    m_parent = nullptr;
+    layout = source->layout;
+    std::vector<dReal> x(source->robots.size()), y(source->robots.size());
+    for (size_t k = 0; k < source->robots.size(); k++)
+        source->robots[k]->getXY(x[k], y[k]);
+    build(x, y);
+    p->copySurfaces(*source->p, source, this);
+    field_geometry = source->field_geometry;
+    field_bytes = source->field_bytes;
+}
+
+void SSLWorld::build(const std::vector<dReal> &x, const std::vector<dReal> &y)
+{
+    const SSLWorldLayout &l = *layout;
+    steps_super = 0;
+    steps_fault = 0;
+    isGLEnabled = true;
+    customDT = -1;
+    show3DCursor = false;
+    updatedCursor = false;
+    frame_num = 0;
+    last_dt = -1;
+    //a world without a parent widget never renders (e.g. extra worlds stepped on worker threads)
+    if (m_parent == nullptr)
+        isGLEnabled = false;
+    g = new CGraphics(m_parent);
+    g->setSphereQuality(1);
+    p = new PWorld(0.05, 9.81f, g, l.robot_count, l.broadphase);
+    p->setThreads(cfg->ODEThreads());
+    p->setCollideThreads(cfg->CollideThreads());
+    p->setAutoDisable(cfg->AutoDisable());
+    setSeed(cfg->Seed());
+    ball = new PBall(0, 0, 0.5, l.ball_radius, l.ball_mass, 1, 0.7, 0);
+
+    ground = new PGround(l.field_rad, l.field_length, l.field_width, l.penalty_depth, l.penalty_width, l.penalty_point, l.line_width, 0);
+    ray = new PRay(50);
+
+    for (int i = 0; i < WALL_COUNT; i++)
+    {
+        const SSLWorldLayout::Box &b = l.walls[i];
+        walls[i] = new PFixedBox(b.x, b.y, b.z, b.w, b.h, b.l, b.r, b.g, b.b);
+        if (b.angle != 0)
+            walls[i]->setRotation(0, 0, 1, b.angle);
+    }
+
+    p->addObject(ground, PClassGround);
+    p->addObject(ball, PClassBall);
+    p->addObject(ray, PClassRay);
     for (auto &wall : walls)
-        p->createSurface(ball, wall)->surface = ballwithwall.surface;
+        p->addObject(wall, PClassWall);
+    const int wheeltexid = 4 * l.robot_count + 12 + 1; //37 for 6 robots
 
-    for (int k = 0; k < 2 * cfg->Robots_Count(); k++)
+    robotSettings = l.robot_settings;
+    robots.resize(l.robot_count * 2);
+    for (int k = 0; k < l.robot_count * 2; k++)
     {
-        p->createSurface(robots[k]->chassis, ground);
-        for (auto &wall : walls)
-            p->createSurface(robots[k]->chassis, wall);
-        p->createSurface(robots[k]->chassis,ball);
-        for (auto &wheel : robots[k]->wheels)
-        {
-            p->createSurface(wheel->cyl, ball);
-            PSurface *w_g = p->createSurface(wheel->cyl, ground);
-            w_g->surface = wheelswithground.surface;
-            w_g->usefdir1 = true;
-            w_g->callback = wheelCallBack;
-        }
-        for (auto &b : robots[k]->balls)
-        {
-            //            p->createSurface(b->pBall,ball);
-            PSurface *w_g = p->createSurface(b->pBall, ground);
-            w_g->surface = wheelswithground.surface;
-            w_g->usefdir1 = true;
-            w_g->callback = wheelCallBack;
-        }
-        for (int j = k + 1; j < 2 * cfg->Robots_Count(); j++)
-        {
-            if (k != j)
-            {
-                p->createSurface(robots[k]->chassis, robots[j]->chassis); //seams ode doesn't understand cylinder-cylinder contacts, so I used spheres
-            }
-        }
+        bool turn_on = true;
+        float dir = 1.0;
+        // if (k > cfg->Robots_Count())
+        // {
+        //     robotSettings = cfg->yellowSettings;
+        //     x = form->x[k - cfg->Robots_Count()];
+        //     y = -form->y[k - cfg->Robots_Count()];
+        //     dir = -1;
+        // }
+        robots[k] = new CRobot(
+            p, ball, cfg, robotSettings,
+            x[k], y[k], ROBOT_START_Z(robotSettings),
+            ROBOT_GRAY, ROBOT_GRAY, ROBOT_GRAY,
+            k + 1, wheeltexid, dir, turn_on);
     }
+    
+
+    p->initAllObjects();
+
+    connect(this, &SSLWorld::visionDatagram, this, &SSLWorld::sendDatagram, Qt::QueuedConnection);
 
     in_buffer = new char[65536];
     ball_speed_estimator = new speedEstimator(false, 0.95, 100000);
-    for (int i = 0; i < cfg->Robots_Count(); i++)
+    for (int i = 0; i < l.robot_count; i++)
     {
-        blue_speed_estimator[i] = new speedEstimator(true, 0.95, 100000);
-        yellow_speed_estimator[i] = new speedEstimator(true, 0.95, 100000);
+        blue_speed_estimator.push_back(new speedEstimator(true, 0.95, 100000));
+        yellow_speed_estimator.push_back(new speedEstimator(true, 0.95, 100000));
     }
 
     // initialize robot state
-    for (int team = 0; team < TEAM_COUNT; ++team)
-    {
-        for (int i = 0; i < MAX_ROBOT_COUNT; ++i)
-        {
-            lastInfraredState[team][i] = false;
-            lastKickState[team][i] = NO_KICK;
-        }
-    }
+    lastInfraredState.assign(robots.size(), false);
+    lastKickState.assign(robots.size(), NO_KICK);
 }
 
 int SSLWorld::robotIndex(unsigned int robot, int team)
@@ -376,12 +478,26 @@ int SSLWorld::robotIndex(unsigned int robot, int team)
     return robot + team * cfg->Robots_Count();
 }
 
+void SSLWorld::setSeed(int seed)
+{
+    //0 keeps the old behaviour of a different run every time
+    const uint64_t s = seed != 0 ? static_cast<uint64_t>(seed) : std::random_device()() ^ static_cast<uint64_t>(time(nullptr));
+    rng.seed(s);
+    p->setSeed(s);
+}
+
 SSLWorld::~SSLWorld()
 {
+    delete ball_speed_estimator;
+    for (auto &e : blue_speed_estimator)
+        delete e;
+    for (auto &e : yellow_speed_estimator)
+        delete e;
     delete g;
     delete p;
 }
 
+#ifndef FIRASIM_HEADLESS
 QImage *createBlob(char yb, int i, QImage **res)
 {
     *res = new QImage(QString(":/%1%2").arg(yb).arg(i) + QString(".png"));
@@ -424,12 +540,12 @@ void SSLWorld::glinit()
 {
     g->loadTexture(new QImage(":/grass.png"));
 
-    // Loading Robot textures for each robot
+    // Loading Robot textures for each robot, the resources only have MAX_ROBOT_COUNT per team
     for (int i = 0; i < cfg->Robots_Count(); i++)
-        g->loadTexture(createBlob('b', i, &robots[i]->img));
+        g->loadTexture(createBlob('b', i % MAX_ROBOT_COUNT, &robots[i]->img));
 
     for (int i = 0; i < cfg->Robots_Count(); i++)
-        g->loadTexture(createBlob('y', i, &robots[cfg->Robots_Count() + i]->img));
+        g->loadTexture(createBlob('y', i % MAX_ROBOT_COUNT, &robots[cfg->Robots_Count() + i]->img));
 
     // Creating number textures
     for (int i = 0; i < cfg->Robots_Count(); i++)
@@ -452,196 +568,533 @@ void SSLWorld::glinit()
     // Init at last
     p->glinit();
 }
+#else
+void SSLWorld::glinit()
+{
+}
+#endif
 
-void SSLWorld::step(dReal dt)
+void SSLWorld::simStep(dReal dt)
 {
-    if (!isGLEnabled)
-        g->disableGraphics();
-    else
-        g->enableGraphics();
     if (customDT > 0)
         dt = customDT;
-
-    const auto ratio = m_parent->devicePixelRatio();
-    if (isGLEnabled)
-        g->initScene(m_parent->width() * ratio, m_parent->height() * ratio, 0, 0.7, 1);
-    // Pq ele faz isso 5 vezes?
-    // - Talvez mais precisao (Ele sempre faz um step de dt*0.2 )
-    for (int kk = 0; kk < 5; kk++)
+    if (dt == 0)
+        dt = last_dt;
+    else
+        last_dt = dt;
+
+    PROFILE_SCOPE(PROFILE_SIM_STEP);
+    if (shmChannel != nullptr)
+        recvSharedActions();
+    if (recorder != nullptr)
+        recordCommands();
+
+    //each step is split in substeps for contact accuracy, see substepCount()
+    const int substeps = substepCount();
+    const bool quick = fullSpeed || cfg->QuickStep();
+    if (p->autoDisable() != cfg->AutoDisable())
+        p->setAutoDisable(cfg->AutoDisable());
+    if (quick)
+        p->setSolverIterations(cfg->SolverIterations());
+    for (int kk = 0; kk < substeps; kk++)
     {
-        const dReal *ballvel = dBodyGetLinearVel(ball->body);
-        // Norma do vetor velocidade da bola
-        dReal ballspeed = ballvel[0] * ballvel[0] + ballvel[1] * ballvel[1] + ballvel[2] * ballvel[2];
-        ballspeed = sqrt(ballspeed);
-        dReal ballfx = 0, ballfy = 0, ballfz = 0;
-        dReal balltx = 0, ballty = 0, balltz = 0;
-        if (ballspeed < 0.01)
         {
+            PROFILE_SCOPE(PROFILE_BALL_FORCES);
+            const dReal *ballvel = dBodyGetLinearVel(ball->body);
+            // Norma do vetor velocidade da bola
+            dReal ballspeed = ballvel[0] * ballvel[0] + ballvel[1] * ballvel[1] + ballvel[2] * ballvel[2];
+            ballspeed = sqrt(ballspeed);
+            dReal ballfx = 0, ballfy = 0, ballfz = 0;
+            dReal balltx = 0, ballty = 0, balltz = 0;
+            if (!dBodyIsEnabled(ball->body))
+            {
+                //a kick or push from the GUI sets velocity or force without waking the ball
+                const dReal *ballforce = dBodyGetForce(ball->body);
+                if (ballspeed > 0 || ballforce[0] != 0 || ballforce[1] != 0 || ballforce[2] != 0)
+                    dBodyEnable(ball->body);
+            }
+            if (ballspeed < 0.01)
+            {
 
-            //const dReal* ballAngVel = dBodyGetAngularVel(ball->body);
-            //TODO: what was supposed to be here?
-            //dReal accel = last_speed - ballspeed;
-            //dReal fk = accel * cfg->BallFriction() * cfg->BallMass() * cfg->Gravity();
-            dBodySetAngularVel(ball->body, 0, 0, 0);
-            dBodySetLinearVel(ball->body, 0, 0, 0);
-        }
-        else
-        {
-            // Velocidade real  normalizada (com atrito envolvido) da bola
-            //dReal accel = last_speed - ballspeed;
-            //accel = -accel / dt;
-            //last_speed = ballspeed;
-            //dReal fk = accel * cfg->BallFriction() * cfg->BallMass() * cfg->Gravity();
-            dReal fk = cfg->BallFriction() * cfg->BallMass() * cfg->Gravity() * cfg->BallSlip();
-            ballfx = -fk * ballvel[0] / ballspeed;
-            ballfy = -fk * ballvel[1] / ballspeed;
-            ballfz = -fk * ballvel[2] / ballspeed;
-            balltx = -ballfy * cfg->BallRadius();
-            ballty = ballfx * cfg->BallRadius();
-            balltz = 0;
-            dBodyAddTorque(ball->body, balltx, ballty, balltz);
-            dBodyAddForce(ball->body,ballfx,ballfy,ballfz);
+                //const dReal* ballAngVel = dBodyGetAngularVel(ball->body);
+                //TODO: what was supposed to be here?
+                //dReal accel = last_speed - ballspeed;
+                //dReal fk = accel * cfg->BallFriction() * cfg->BallMass() * cfg->Gravity();
+                dBodySetAngularVel(ball->body, 0, 0, 0);
+                dBodySetLinearVel(ball->body, 0, 0, 0);
+                //a stopped ball on the ground sleeps until a contact, replacement or kick wakes it
+                dReal x, y, z;
+                ball->getBodyPosition(x, y, z);
+                if (cfg->AutoDisable() && z < cfg->BallRadius() * 1.1)
+                    dBodyDisable(ball->body);
+            }
+            else
+            {
+                // Velocidade real  normalizada (com atrito envolvido) da bola
+                //dReal accel = last_speed - ballspeed;
+                //accel = -accel / dt;
+                //last_speed = ballspeed;
+                //dReal fk = accel * cfg->BallFriction() * cfg->BallMass() * cfg->Gravity();
+                dReal fk = cfg->BallFriction() * cfg->BallMass() * cfg->Gravity() * cfg->BallSlip();
+                ballfx = -fk * ballvel[0] / ballspeed;
+                ballfy = -fk * ballvel[1] / ballspeed;
+                ballfz = -fk * ballvel[2] / ballspeed;
+                balltx = -ballfy * cfg->BallRadius();
+                ballty = ballfx * cfg->BallRadius();
+                balltz = 0;
+                dBodyAddTorque(ball->body, balltx, ballty, balltz);
+                dBodyAddForce(ball->body,ballfx,ballfy,ballfz);
+            }
         }
         //dBodyAddForce(ball->body, ballfx, ballfy, ballfz);
-        if (dt == 0)
-            dt = last_dt;
-        else
-            last_dt = dt;
-
         selected = -1;
-        p->step(dt * 0.2, fullSpeed);
+        p->step(dt / substeps, quick);
     }
 
     steps_super++;
-
-    int best_k = -1;
-    dReal best_dist = 1e8;
-    dReal xyz[3], hpr[3];
-    if (selected == -2)
+    ball->tag = -1;
     {
-        best_k = -2;
-        dReal bx, by, bz;
-        ball->getBodyPosition(bx, by, bz);
-        g->getViewpoint(xyz, hpr);
-        best_dist = (bx - xyz[0]) * (bx - xyz[0]) + (by - xyz[1]) * (by - xyz[1]) + (bz - xyz[2]) * (bz - xyz[2]);
+        PROFILE_SCOPE(PROFILE_ROBOTS);
+        for (int k = 0; k < cfg->Robots_Count() * 2; k++)
+            robots[k]->step();
     }
+    if (recorder != nullptr)
+        recordFrame();
+}
+
+void SSLWorld::recordCommands()
+{
+    //wheel speeds this step runs with, in the sign convention of recvActions
     for (int k = 0; k < cfg->Robots_Count() * 2; k++)
     {
-        if (robots[k]->selected)
-        {
-            g->getViewpoint(xyz, hpr);
-            dReal dist = (robots[k]->select_x - xyz[0]) * (robots[k]->select_x - xyz[0]) + (robots[k]->select_y - xyz[1]) * (robots[k]->select_y - xyz[1]) + (robots[k]->select_z - xyz[2]) * (robots[k]->select_z - xyz[2]);
-            if (dist < best_dist)
-            {
-                best_dist = dist;
-                best_k = k;
-            }
-        }
-        robots[k]->chassis->setColor(ROBOT_GRAY, ROBOT_GRAY, ROBOT_GRAY);
+        RecordRobot &r = k < cfg->Robots_Count() ? record_frame.blue[k] : record_frame.yellow[k - cfg->Robots_Count()];
+        r.wheel_left = -1 * robots[k]->wheels[0]->speed;
+        r.wheel_right = robots[k]->wheels[1]->speed;
     }
-    if (best_k >= 0)
-        robots[best_k]->chassis->setColor(ROBOT_GRAY * 2, ROBOT_GRAY * 1.5, ROBOT_GRAY * 1.5);
-    selected = best_k;
-    ball->tag = -1;
+}
+
+void SSLWorld::recordFrame()
+{
+    //ground truth, the same values fillPacket reads before adding noise
+    RecordFrame &f = record_frame;
+    f.sim_frame = steps_super;
+    f.step = steps_super * cfg->DeltaTime() * 1000;
+    f.goals_blue = goals_blue;
+    f.goals_yellow = goals_yellow;
+    f.robots_per_team = cfg->Robots_Count();
+    dReal x, y, z;
+    ball->getBodyPosition(x, y, z);
+    const dReal *v = dBodyGetLinearVel(ball->body);
+    f.ball[0] = x;
+    f.ball[1] = y;
+    f.ball[2] = z;
+    f.ball[3] = v[0];
+    f.ball[4] = v[1];
+    for (int k = 0; k < MAX_ROBOT_COUNT * 2; k++)
+    {
+        RecordRobot &r = k < MAX_ROBOT_COUNT ? f.blue[k] : f.yellow[k - MAX_ROBOT_COUNT];
+        const int id = robotIndex(k % MAX_ROBOT_COUNT, k / MAX_ROBOT_COUNT);
+        r.on = id >= 0 && robots[id]->on;
+        if (!r.on)
+            continue;
+        robots[id]->getXY(x, y);
+        const dReal *lin = dBodyGetLinearVel(robots[id]->chassis->body);
+        const dReal *ang = dBodyGetAngularVel(robots[id]->chassis->body);
+        r.x = x;
+        r.y = y;
+        r.orientation = normalizeAngle(robots[id]->getDir()) * M_PI / 180.0;
+        r.vx = lin[0];
+        r.vy = lin[1];
+        r.vorientation = ang[2];
+    }
+    recorder->record(f);
+}
+
+int SSLWorld::substepCount()
+{
+    const int substeps = std::max(1, cfg->Substeps());
+    if (!cfg->AdaptiveSubsteps())
+        return substeps;
+    //full substeps as soon as the ball or any robot moves (or is commanded to move) fast
+    const dReal limit = cfg->AdaptiveSpeedThreshold();
+    const dReal limit2 = limit * limit;
+    const dReal *v = dBodyGetLinearVel(ball->body);
+    if (v[0] * v[0] + v[1] * v[1] + v[2] * v[2] > limit2)
+        return substeps;
     for (int k = 0; k < cfg->Robots_Count() * 2; k++)
     {
-        robots[k]->step();
-        robots[k]->selected = false;
+        CRobot *r = robots[k];
+        if (!r->on)
+            continue;
+        v = dBodyGetLinearVel(r->chassis->body);
+        if (v[0] * v[0] + v[1] * v[1] + v[2] * v[2] > limit2)
+            return substeps;
+        const dReal wheel_r = robotSettings.WheelRadius;
+        if (fabs(r->wheels[0]->speed) * wheel_r > limit || fabs(r->wheels[1]->speed) * wheel_r > limit)
+            return substeps;
     }
-    if (g->isGraphicsEnabled())
+    return std::min(substeps, std::max(1, cfg->MinSubsteps()));
+}
+
+void SSLWorld::step(dReal dt)
+{
+    QMutexLocker locker(&mutex);
+    if (!isGLEnabled)
+        g->disableGraphics();
+    else
+        g->enableGraphics();
+
+#ifndef FIRASIM_HEADLESS
+    if (isGLEnabled)
     {
-        p->draw();
-        //g->drawSkybox(31,32,33,34,35,36);
-        g->drawSkybox(4 * cfg->Robots_Count() + 6 + 1,  //31 for 6 robot
-                      4 * cfg->Robots_Count() + 6 + 2,  //32 for 6 robot
-                      4 * cfg->Robots_Count() + 6 + 3,  //33 for 6 robot
-                      4 * cfg->Robots_Count() + 6 + 4,  //34 for 6 robot
-                      4 * cfg->Robots_Count() + 6 + 5,  //31 for 6 robot
-                      4 * cfg->Robots_Count() + 6 + 6); //36 for 6 robot
+        const auto ratio = m_parent->devicePixelRatio();
+        g->initScene(m_parent->width() * ratio, m_parent->height() * ratio, 0, 0.7, 1);
     }
+#endif
 
-    dMatrix3 R;
+    if (!lockStep && !freeRunning)
+        simStep(dt);
 
-    if (g->isGraphicsEnabled())
-        if (show3DCursor)
+    {
+        //closed before sendVisionBuffer, which is timed as vision
+        PROFILE_SCOPE(PROFILE_RENDER);
+        int best_k = -1;
+        dReal best_dist = 1e8;
+        dReal xyz[3], hpr[3];
+        if (selected == -2)
+        {
+            best_k = -2;
+            dReal bx, by, bz;
+            ball->getBodyPosition(bx, by, bz);
+            g->getViewpoint(xyz, hpr);
+            best_dist = (bx - xyz[0]) * (bx - xyz[0]) + (by - xyz[1]) * (by - xyz[1]) + (bz - xyz[2]) * (bz - xyz[2]);
+        }
+        for (int k = 0; k < cfg->Robots_Count() * 2; k++)
         {
-            dRFromAxisAndAngle(R, 0, 0, 1, 0);
-            g->setColor(1, 0.9, 0.2, 0.5);
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            g->drawCircle(cursor_x, cursor_y, 0.001, cursor_radius);
-            glDisable(GL_BLEND);
+            if (robots[k]->selected)
+            {
+                g->getViewpoint(xyz, hpr);
+                dReal dist = (robots[k]->select_x - xyz[0]) * (robots[k]->select_x - xyz[0]) + (robots[k]->select_y - xyz[1]) * (robots[k]->select_y - xyz[1]) + (robots[k]->select_z - xyz[2]) * (robots[k]->select_z - xyz[2]);
+                if (dist < best_dist)
+                {
+                    best_dist = dist;
+                    best_k = k;
+                }
+            }
+            robots[k]->chassis->setColor(ROBOT_GRAY, ROBOT_GRAY, ROBOT_GRAY);
         }
+        if (best_k >= 0)
+            robots[best_k]->chassis->setColor(ROBOT_GRAY * 2, ROBOT_GRAY * 1.5, ROBOT_GRAY * 1.5);
+        selected = best_k;
+        for (int k = 0; k < cfg->Robots_Count() * 2; k++)
+            robots[k]->selected = false;
+        if (g->isGraphicsEnabled())
+        {
+            p->draw();
+            //g->drawSkybox(31,32,33,34,35,36);
+            g->drawSkybox(4 * cfg->Robots_Count() + 6 + 1,  //31 for 6 robot
+                          4 * cfg->Robots_Count() + 6 + 2,  //32 for 6 robot
+                          4 * cfg->Robots_Count() + 6 + 3,  //33 for 6 robot
+                          4 * cfg->Robots_Count() + 6 + 4,  //34 for 6 robot
+                          4 * cfg->Robots_Count() + 6 + 5,  //31 for 6 robot
+                          4 * cfg->Robots_Count() + 6 + 6); //36 for 6 robot
+        }
+
+#ifndef FIRASIM_HEADLESS
+        dMatrix3 R;
+        if (g->isGraphicsEnabled())
+            if (show3DCursor)
+            {
+                dRFromAxisAndAngle(R, 0, 0, 1, 0);
+                g->setColor(1, 0.9, 0.2, 0.5);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                g->drawCircle(cursor_x, cursor_y, 0.001, cursor_radius);
+                glDisable(GL_BLEND);
+            }
+#endif
 
-    if (g->isGraphicsEnabled())
-        g->finalizeScene();
+        if (g->isGraphicsEnabled())
+            g->finalizeScene();
+    }
 
+    if (lockStep || freeRunning)
+        return;
     sendVisionBuffer();
     //Internal Arbiter. Not used.
     //posProcess();
     
+    endFrame();
+}
+
+void SSLWorld::advance(dReal dt)
+{
+    QMutexLocker locker(&mutex);
+    simStep(dt);
+    sendVisionBuffer();
+    endFrame();
+}
+
+void SSLWorld::endFrame()
+{
+    //step(), advance() and simulate() all build their packet first, so a frame has the
+    //same number (and the same geometryDue()) whichever of them produced it
     frame_num++;
     received = false;
 }
 
+void SSLWorld::saveState(QByteArray &state)
+{
+    QMutexLocker locker(&mutex);
+    writeState(state);
+}
+
+void SSLWorld::writeState(QByteArray &state)
+{
+    const int body_count = p->bodyCount();
+    const int robot_count = cfg->Robots_Count() * 2;
+    int size = sizeof(WorldStateHeader) + body_count * sizeof(PBodyState) + robot_count * sizeof(WorldRobotState);
+    for (int i = 0; i < send_count; i++)
+        size += 2 * sizeof(int32_t) + sendQueue[(send_head + i) % sendQueue.size()].data.size();
+    state.resize(size);
+    char *out = state.data();
+
+    auto *h = reinterpret_cast<WorldStateHeader *>(out);
+    memset(h, 0, sizeof(WorldStateHeader));
+    h->magic = STATE_MAGIC;
+    h->version = STATE_VERSION;
+    h->body_count = body_count;
+    h->robot_count = robot_count;
+    h->send_count = send_count;
+    h->steps_super = steps_super;
+    h->steps_fault = steps_fault;
+    h->frame_num = frame_num;
+    h->minute = minute;
+    h->goals_blue = goals_blue;
+    h->goals_yellow = goals_yellow;
+    h->ball_tag = ball->tag;
+    h->received = received;
+    h->geometry_pending = geometry_pending;
+    h->last_dt = last_dt;
+    h->ball_prev_x = ball_prev_pos.first;
+    h->ball_prev_y = ball_prev_pos.second;
+    memcpy(h->rng, rng.s, sizeof(h->rng));
+    h->rng_deviate = rng.storedDeviate;
+    h->rng_deviate_available = rng.deviateAvailable;
+    h->ode_seed = p->getSeed();
+    out += sizeof(WorldStateHeader);
+
+    p->saveBodies(reinterpret_cast<PBodyState *>(out));
+    out += body_count * sizeof(PBodyState);
+    auto *robot_states = reinterpret_cast<WorldRobotState *>(out);
+    memset(robot_states, 0, robot_count * sizeof(WorldRobotState));
+    for (int k = 0; k < robot_count; k++)
+    {
+        robots[k]->saveState(robot_states[k].robot);
+        robot_states[k].kick = lastKickState[k];
+        robot_states[k].infrared = lastInfraredState[k];
+    }
+    out += robot_count * sizeof(WorldRobotState);
+
+    for (int i = 0; i < send_count; i++)
+    {
+        const SendingPacket &packet = sendQueue[(send_head + i) % sendQueue.size()];
+        const int32_t header[2] = {packet.t, static_cast<int32_t>(packet.data.size())};
+        memcpy(out, header, sizeof(header));
+        memcpy(out + sizeof(header), packet.data.constData(), packet.data.size());
+        out += sizeof(header) + packet.data.size();
+    }
+}
+
+bool SSLWorld::restoreState(const QByteArray &state)
+{
+    QMutexLocker locker(&mutex);
+    const int robot_count = cfg->Robots_Count() * 2;
+    if (state.size() < static_cast<int>(sizeof(WorldStateHeader)))
+        return false;
+    const char *in = state.constData();
+    const char *end = in + state.size();
+    const auto *h = reinterpret_cast<const WorldStateHeader *>(in);
+    if (h->magic != STATE_MAGIC || h->version != STATE_VERSION ||
+        h->body_count != p->bodyCount() || h->robot_count != robot_count)
+        return false;
+    in += sizeof(WorldStateHeader);
+    //check the whole blob before touching the world, a failed restore leaves it as it was
+    const long fixed_size = h->body_count * sizeof(PBodyState) + robot_count * sizeof(WorldRobotState);
+    if (end - in < fixed_size)
+        return false;
+    const char *frames = in + fixed_size;
+    for (int i = 0; i < h->send_count; i++)
+    {
+        int32_t header[2];
+        if (end - frames < static_cast<long>(sizeof(header)))
+            return false;
+        memcpy(header, frames, sizeof(header));
+        if (header[1] < 0 || end - frames - static_cast<long>(sizeof(header)) < header[1])
+            return false;
+        frames += sizeof(header) + header[1];
+    }
+
+    //switching robots on or off enables their bodies and clears velocities, so it goes
+    //first and the saved bodies, sleeping flags included, are applied over it
+    const auto *robot_states = reinterpret_cast<const WorldRobotState *>(in + h->body_count * sizeof(PBodyState));
+    for (int k = 0; k < robot_count; k++)
+        robots[k]->setOn(robot_states[k].robot.on);
+    p->restoreBodies(reinterpret_cast<const PBodyState *>(in));
+    in += h->body_count * sizeof(PBodyState);
+    for (int k = 0; k < robot_count; k++)
+    {
+        robots[k]->restoreState(robot_states[k].robot);
+        lastKickState[k] = static_cast<KickStatus>(robot_states[k].kick);
+        lastInfraredState[k] = robot_states[k].infrared;
+    }
+    in += robot_count * sizeof(WorldRobotState);
+
+    send_head = 0;
+    send_count = 0;
+    while (sendQueue.size() < h->send_count)
+        growSendQueue();
+    for (int i = 0; i < h->send_count; i++)
+    {
+        int32_t header[2];
+        memcpy(header, in, sizeof(header));
+        in += sizeof(header);
+        SendingPacket &packet = sendQueue[i];
+        packet.t = header[0];
+        packet.data.resize(header[1]);
+        memcpy(packet.data.data(), in, header[1]);
+        in += header[1];
+        send_count++;
+    }
+
+    steps_super = h->steps_super;
+    steps_fault = h->steps_fault;
+    frame_num = h->frame_num;
+    minute = h->minute;
+    goals_blue = h->goals_blue;
+    goals_yellow = h->goals_yellow;
+    ball->tag = h->ball_tag;
+    received = h->received;
+    geometry_pending = h->geometry_pending;
+    last_dt = h->last_dt;
+    ball_prev_pos = std::make_pair(h->ball_prev_x, h->ball_prev_y);
+    memcpy(rng.s, h->rng, sizeof(h->rng));
+    rng.storedDeviate = h->rng_deviate;
+    rng.deviateAvailable = h->rng_deviate_available;
+    p->setSeed(h->ode_seed);
+    return true;
+}
+
+SSLWorld *SSLWorld::clone()
+{
+    //ODE cannot copy a world, so the clone is built from our layout and surfaces without
+    //graphics and then takes over our state
+    QMutexLocker locker(&mutex);
+    QByteArray state;
+    writeState(state);
+    auto *copy = new SSLWorld(this);
+    locker.unlock();
+    copy->restoreState(state);
+    copy->customDT = customDT;
+    copy->withGoalKick = withGoalKick;
+    copy->randomStart = randomStart;
+    copy->fullSpeed = fullSpeed;
+    return copy;
+}
+
+void SSLWorld::simulate(const Packet &packet, Environment *env)
+{
+    QMutexLocker locker(&mutex);
+    processPacket(packet);
+    simStep(cfg->DeltaTime());
+    fillPacket(env);
+    if (geometryDue())
+        env->mutable_field()->CopyFrom(field_geometry);
+    endFrame();
+}
+
 void SSLWorld::recvActions()
 {
     QHostAddress sender;
     quint16 port;
     Packet packet;
+    if (commandSocket == nullptr)
+        return;
     while (commandSocket->hasPendingDatagrams())
     {
         qint64 size = commandSocket->readDatagram(in_buffer, 65536, &sender, &port);
         if (size > 0)
         {
             packet.ParseFromArray(in_buffer, static_cast<int>(size));
-            if (packet.has_cmd())
-            {
-                for (const auto &robot_cmd : packet.cmd().robot_commands())
-                {
-                    int id = robotIndex(robot_cmd.id(), robot_cmd.yellowteam());
-                    if ((id < 0) || (id >= cfg->Robots_Count() * 2))
-                        continue;
-                        
-                    if (isnanf(robot_cmd.wheel_left()) || isnanf(robot_cmd.wheel_right())){
-                    	std::cout << "[ERROR] Received an NaN (not a number) command for wheels by team " << (robot_cmd.yellowteam() ? "yellow" : "blue") << std::endl;
-                    	continue;
-                    }
-                        
-                    robots[id]->setSpeed(0, -1 * robot_cmd.wheel_left());
-                    robots[id]->setSpeed(1, robot_cmd.wheel_right());
-                }
-                received = true;
-            }
-            if (packet.has_replace())
-            {
-                for (const auto &replace : packet.replace().robots())
-                {
-                    int id = robotIndex(replace.position().robot_id(), replace.yellowteam());
-                    if ((id < 0) || (id >= cfg->Robots_Count() * 2))
-                        continue;
-                    robots[id]->setXY(replace.position().x(), replace.position().y());
-                    robots[id]->setDir(replace.position().orientation());
-                    robots[id]->on = replace.turnon();
-                }
-                if (packet.replace().has_ball())
-                {
-                    dReal x = 0, y = 0, z = 0, vx = 0, vy = 0;
-                    ball->getBodyPosition(x, y, z);
-                    const auto vel_vec = dBodyGetLinearVel(ball->body);
-                    vx = vel_vec[0];
-                    vy = vel_vec[1];
-
-                    x = packet.replace().ball().x();
-                    y = packet.replace().ball().y();
-                    vx = packet.replace().ball().vx();
-                    vy = packet.replace().ball().vy();
-
-                    ball->setBodyPosition(x, y, cfg->BallRadius() * 1.2);
-                    dBodySetLinearVel(ball->body, vx, vy, 0);
-                    dBodySetAngularVel(ball->body, 0, 0, 0);
-                }
+            QMutexLocker locker(&mutex);
+            processPacket(packet);
+        }
+    }
+}
+
+void SSLWorld::recvSharedActions()
+{
+    ShmCommand cmd;
+    while (shmChannel->popCommand(cmd))
+    {
+        int id = robotIndex(cmd.robot_id, cmd.yellowteam);
+        if ((id < 0) || (id >= cfg->Robots_Count() * 2))
+            continue;
+        if (std::isnan(cmd.wheel_left) || std::isnan(cmd.wheel_right))
+            continue;
+        robots[id]->setSpeed(0, -1 * cmd.wheel_left);
+        robots[id]->setSpeed(1, cmd.wheel_right);
+        received = true;
+    }
+}
+
+void SSLWorld::processPacket(const Packet &packet)
+{
+    if (packet.has_cmd())
+    {
+        for (const auto &robot_cmd : packet.cmd().robot_commands())
+        {
+            int id = robotIndex(robot_cmd.id(), robot_cmd.yellowteam());
+            if ((id < 0) || (id >= cfg->Robots_Count() * 2))
+                continue;
+                
+            if (isnanf(robot_cmd.wheel_left()) || isnanf(robot_cmd.wheel_right())){
+            	std::cout << "[ERROR] Received an NaN (not a number) command for wheels by team " << (robot_cmd.yellowteam() ? "yellow" : "blue") << std::endl;
+            	continue;
             }
+                
+            robots[id]->setSpeed(0, -1 * robot_cmd.wheel_left());
+            robots[id]->setSpeed(1, robot_cmd.wheel_right());
+        }
+        received = true;
+    }
+    if (packet.has_replace())
+    {
+        for (const auto &replace : packet.replace().robots())
+        {
+            int id = robotIndex(replace.position().robot_id(), replace.yellowteam());
+            if ((id < 0) || (id >= cfg->Robots_Count() * 2))
+                continue;
+            robots[id]->setXY(replace.position().x(), replace.position().y());
+            robots[id]->setDir(replace.position().orientation());
+            robots[id]->setOn(replace.turnon());
+        }
+        if (packet.replace().has_ball())
+        {
+            dReal x = 0, y = 0, z = 0, vx = 0, vy = 0;
+            ball->getBodyPosition(x, y, z);
+            const auto vel_vec = dBodyGetLinearVel(ball->body);
+            vx = vel_vec[0];
+            vy = vel_vec[1];
+
+            x = packet.replace().ball().x();
+            y = packet.replace().ball().y();
+            vx = packet.replace().ball().vx();
+            vy = packet.replace().ball().vy();
+
+            ball->setBodyPosition(x, y, cfg->BallRadius() * 1.2);
+            dBodySetLinearVel(ball->body, vx, vy, 0);
+            dBodySetAngularVel(ball->body, 0, 0, 0);
         }
     }
 }
@@ -657,9 +1110,17 @@ dReal normalizeAngle(dReal a)
 
 Environment *SSLWorld::generatePacket()
 {
+    auto *env = new Environment;
+    fillPacket(env);
+    env->mutable_field()->CopyFrom(field_geometry);
+    return env;
+}
 
+void SSLWorld::fillPacket(Environment *env)
+{
+    //Clear() keeps the nested messages allocated, so a reused env costs no allocation
+    env->Clear();
     int t = steps_super * cfg->DeltaTime() * 1000;
-    auto *env = new Environment;
     dReal x, y, z, dir, k;
     ball->getBodyPosition(x, y, z);
     //Estimating Ball Speed
@@ -683,21 +1144,21 @@ Environment *SSLWorld::generatePacket()
         dev_y = 0;
         dev_a = 0;
     }
-    if (!cfg->vanishing() || (rand0_1() > cfg->ball_vanishing()))
+    if (!cfg->vanishing() || (rng.uniform() > cfg->ball_vanishing()))
     {
         auto *vball = env->mutable_frame()->mutable_ball();
-        vball->set_x(randn_notrig(x, dev_x));
-        vball->set_y(randn_notrig(y, dev_y));
+        vball->set_x(rng.normal(x, dev_x));
+        vball->set_y(rng.normal(y, dev_y));
         vball->set_z(z);
         vball->set_vx(ball_vel[0]);
         vball->set_vy(ball_vel[1]);
     }
     for (uint32_t i = 0; i < cfg->Robots_Count() * 2; i++)
     {
-        if (!cfg->vanishing() || (rand0_1() > cfg->blue_team_vanishing()))
+        if (!robots[i]->on)
+            continue;
+        if (!cfg->vanishing() || (rng.uniform() > cfg->blue_team_vanishing()))
         {
-            if (!robots[i]->on)
-                continue;
             robots[i]->getXY(x, y);
             dir = robots[i]->getDir(k);
             //Estimating speeds for robots
@@ -744,51 +1205,108 @@ Environment *SSLWorld::generatePacket()
                 rob->set_robot_id(i - cfg->Robots_Count());
             else
                 rob->set_robot_id(i);
-            rob->set_x(randn_notrig(x, dev_x));
-            rob->set_y(randn_notrig(y, dev_y));
-            rob->set_orientation(normalizeAngle(randn_notrig(dir, dev_a)) * M_PI / 180.0);
+            rob->set_x(rng.normal(x, dev_x));
+            rob->set_y(rng.normal(y, dev_y));
+            rob->set_orientation(normalizeAngle(rng.normal(dir, dev_a)) * M_PI / 180.0);
             rob->set_vx(robot_vel[0]);
             rob->set_vy(robot_vel[1]);
             rob->set_vorientation(robot_angular_vel[2]);
         }
     }
-    fira_message::Field *field = env->mutable_field();
-    field->set_width(cfg->Field_Width());
-    field->set_length(cfg->Field_Length());
-    field->set_goal_depth(cfg->Goal_Depth());
-    field->set_goal_width(cfg->Goal_Width());
-    field->set_center_radius(cfg->Field_Rad());
-    field->set_penalty_width(cfg->Field_Penalty_Width());
-    field->set_penalty_depth(cfg->Field_Penalty_Depth());
-    field->set_penalty_point(cfg->Field_Penalty_Point());
     env->set_step(t);
     env->set_goals_blue(this->goals_blue);
     env->set_goals_yellow(this->goals_yellow);
-    return env;
 }
 
-SendingPacket::SendingPacket(fira_message::sim_to_ref::Environment *_packet, int _t)
+void SSLWorld::updateFieldGeometry()
 {
-    packet = _packet;
-    t = _t;
+    field_geometry.set_width(cfg->Field_Width());
+    field_geometry.set_length(cfg->Field_Length());
+    field_geometry.set_goal_depth(cfg->Goal_Depth());
+    field_geometry.set_goal_width(cfg->Goal_Width());
+    field_geometry.set_center_radius(cfg->Field_Rad());
+    field_geometry.set_penalty_width(cfg->Field_Penalty_Width());
+    field_geometry.set_penalty_depth(cfg->Field_Penalty_Depth());
+    field_geometry.set_penalty_point(cfg->Field_Penalty_Point());
+    //serialized as Environment.field (tag included), so it can be appended to any serialized Environment
+    Environment env;
+    env.mutable_field()->CopyFrom(field_geometry);
+    field_bytes.resize(env.ByteSize());
+    env.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8 *>(field_bytes.data()));
+    geometry_pending = true;
+}
+
+const fira_message::Field &SSLWorld::fieldGeometry() const
+{
+    return field_geometry;
+}
+
+void SSLWorld::requestGeometry()
+{
+    geometry_pending = true;
+}
+
+bool SSLWorld::geometryDue()
+{
+    const int every = cfg->sendGeometryEvery();
+    if (geometry_pending || every <= 1 || frame_num % every == 0)
+    {
+        geometry_pending = false;
+        return true;
+    }
+    return false;
+}
+
+void SSLWorld::growSendQueue()
+{
+    QVector<SendingPacket> grown(qMax(4, sendQueue.size() * 2));
+    for (int i = 0; i < send_count; i++)
+        grown[i] = std::move(sendQueue[(send_head + i) % sendQueue.size()]);
+    sendQueue.swap(grown);
+    send_head = 0;
 }
 
 void SSLWorld::sendVisionBuffer()
 {
+    if (visionServer == nullptr && shmChannel == nullptr)
+        return;
+    PROFILE_SCOPE(PROFILE_VISION);
+    fillPacket(&vision_packet);
+    if (shmChannel != nullptr)
+        shmChannel->publish(vision_packet, cfg->Robots_Count());
+    if (visionServer == nullptr)
+        return;
     int t = steps_super * cfg->DeltaTime() * 1000;
-    sendQueue.push_back(new SendingPacket(generatePacket(), t));
-    while (t - sendQueue.front()->t >= cfg->sendDelay())
+    if (send_count == sendQueue.size())
+        growSendQueue();
+    SendingPacket &slot = sendQueue[(send_head + send_count) % sendQueue.size()];
+    const int size = vision_packet.ByteSize();
+    const bool geometry = geometryDue();
+    slot.data.resize(size + (geometry ? field_bytes.size() : 0));
+    vision_packet.SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8 *>(slot.data.data()));
+    if (geometry)
+        memcpy(slot.data.data() + size, field_bytes.constData(), field_bytes.size());
+    slot.t = t;
+    send_count++;
+    //the socket belongs to our thread, frames stepped on a SimThread are handed over to it
+    const bool foreign = QThread::currentThread() != thread();
+    while (send_count > 0 && t - sendQueue[send_head].t >= cfg->sendDelay())
     {
-        Environment *packet = sendQueue.front()->packet;
-        delete sendQueue.front();
-        sendQueue.pop_front();
-        visionServer->send(*packet);
-        delete packet;
-        if (sendQueue.isEmpty())
-            break;
+        if (foreign)
+            emit visionDatagram(sendQueue[send_head].data);
+        else
+            visionServer->send(sendQueue[send_head].data);
+        send_head = (send_head + 1) % sendQueue.size();
+        send_count--;
     }
 }
 
+void SSLWorld::sendDatagram(const QByteArray &datagram)
+{
+    if (visionServer != nullptr)
+        visionServer->send(datagram);
+}
+
 void SSLWorld::posProcess()
 {
 	bool side;
@@ -1004,19 +1522,13 @@ void SSLWorld::posProcess()
             dReal posX[6] = {0.15,0.35,0.71,-0.08,-0.35,-0.71};
             dReal posY[6] = {0.02,0.13,-0.02,0.02,0.13,-0.02};
             
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i]*(-1),posY[i]);
-            }
+            placeRobots(posX, posY, -1);
             
         }else
         {
             dReal posX[6] = {0.08,0.35,0.71,-0.15,-0.35,-0.71};
             dReal posY[6] = {0.02,0.13,-0.02,0.02,0.13,-0.02};
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i]*(-1),posY[i]);
-            }
+            placeRobots(posX, posY, -1);
         }if(end_time){
             steps_fault = 0;
             steps_super = 0;
@@ -1036,10 +1548,7 @@ void SSLWorld::posProcess()
             dReal posX[6] = {-0.575,-0.44,-0.71,-0.175,-0.3,0.71};
             dReal posY[6] = {-0.4,0.13,-0.02,-0.4,0.13,-0.02};
             
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i],posY[i]);
-            }
+            placeRobots(posX, posY, 1);
 
         }else if(quadrant == 1){
             ball->setBodyPosition(-0.375,0.4,0);
@@ -1049,10 +1558,7 @@ void SSLWorld::posProcess()
             dReal posX[6] = {-0.575,-0.44,-0.71,-0.175,-0.30,0.71};
             dReal posY[6] = {0.4,-0.13,-0.02,0.4,-0.13,-0.02};
             
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i],posY[i]);
-            }
+            placeRobots(posX, posY, 1);
         }else if(quadrant == 2){
             ball->setBodyPosition(0.375,-0.4,0);
             dBodySetLinearVel(ball->body, 0, 0, 0);
@@ -1061,10 +1567,7 @@ void SSLWorld::posProcess()
             dReal posX[6] = {0.175,0.3,-0.71,0.575,0.44,0.71};
             dReal posY[6] = {-0.4,0.13,-0.02,-0.4,0.13,-0.02};
             
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i],posY[i]);
-            }
+            placeRobots(posX, posY, 1);
         }else if(quadrant == 3){
             ball->setBodyPosition(0.375,0.4,0);
             dBodySetLinearVel(ball->body, 0, 0, 0);
@@ -1073,10 +1576,7 @@ void SSLWorld::posProcess()
             dReal posX[6] = {0.175,0.3,-0.71,0.575,0.44,0.71};
             dReal posY[6] = {0.4,-0.13,-0.02,0.4,-0.13,-0.02};
             
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i],posY[i]);
-            }
+            placeRobots(posX, posY, 1);
         }
         steps_fault = 0;
 
@@ -1093,11 +1593,7 @@ void SSLWorld::posProcess()
             dBodySetLinearVel(ball->body, 0, 0, 0);
             dBodySetAngularVel(ball->body, 0, 0, 0);
 
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i]*(-1),posY[i]);
-
-            }
+            placeRobots(posX, posY, -1);
         }else
         {
             dReal posX[6] = {0.35, -0.05,-0.74,0.75, -0.06, -0.06};
@@ -1107,11 +1603,7 @@ void SSLWorld::posProcess()
             ball->setBodyPosition(0.47,-0.01,0);
             dBodySetLinearVel(ball->body, 0, 0, 0);
             dBodySetAngularVel(ball->body, 0, 0, 0);
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i],posY[i]);
-
-            }
+            placeRobots(posX, posY, 1);
         }
         
     }else if(goal_shot){
@@ -1125,19 +1617,13 @@ void SSLWorld::posProcess()
             ball->setBodyPosition(0.61, 0.11,0);
             dBodySetLinearVel(ball->body, 0, 0, 0);
             dBodySetAngularVel(ball->body, 0, 0, 0);
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i],posY[i]);
-            }
+            placeRobots(posX, posY, 1);
         }else
         {
             ball->setBodyPosition(-0.61, 0.11,0);
             dBodySetLinearVel(ball->body, 0, 0, 0);
             dBodySetAngularVel(ball->body, 0, 0, 0);
-            for (uint32_t i = 0; i < cfg->Robots_Count()*2; i++)
-            {
-                robots[i]->setXY(posX[i]*(-1),posY[i]);
-            }
+            placeRobots(posX, posY, -1);
         }
 
     }
@@ -1148,29 +1634,75 @@ void SSLWorld::getValidPosition(dReal &x, dReal &y, uint32_t max){
     float LO_Y = -0.55;
     float HI_X = 0.65;
     float HI_Y = 0.55;
-    srand(static_cast<unsigned>(time(0)));
     bool validPlace;
     max = max > 0 ? max : cfg->Robots_Count() * 2;
     do{
         validPlace = true;
-        x = LO_X + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / (HI_X - LO_X)));
-        y = LO_Y + static_cast<float>(rand()) / (static_cast<float>(RAND_MAX / (HI_Y - LO_Y)));
+        x = rng.uniform(LO_X, HI_X);
+        y = rng.uniform(LO_Y, HI_Y);
         for(uint32_t i = 0; i < max; i++){
             dReal x2, y2;
             robots[i]->getXY(x2,y2);
-            if(sqrt(((x-x2)*(x-x2))+((y-y2)*(y-y2))) <= ((cfg)->robotSettings.RobotRadius*2)){
+            if(sqrt(((x-x2)*(x-x2))+((y-y2)*(y-y2))) <= (robotSettings.RobotRadius*2)){
                 validPlace = false;
             }
         }
     }while(!validPlace);
 }
 
-void RobotsFormation::setAll(const dReal *xx, const dReal *yy)
+void SSLWorld::placeRobots(const dReal *posX, const dReal *posY, dReal sx)
 {
-    for (int i = 0; i < 2*cfg->Robots_Count(); i++)
+    //the restart tables place 3 robots per team, the rest go to free spots around them
+    const int n = cfg->Robots_Count();
+    std::vector<std::pair<dReal, dReal>> taken;
+    dReal x, y, z;
+    ball->getBodyPosition(x, y, z);
+    taken.emplace_back(x, y);
+    for (int i = 0; i < n * 2; i++)
+    {
+        if (i % n >= 3)
+            continue;
+        const int k = (i / n) * 3 + i % n;
+        robots[i]->setXY(posX[k] * sx, posY[k]);
+        taken.emplace_back(posX[k] * sx, posY[k]);
+    }
+    for (int i = 0; i < n * 2; i++)
+    {
+        if (i % n < 3)
+            continue;
+        freeSpot(taken, x, y);
+        robots[i]->setXY(x, y);
+        taken.emplace_back(x, y);
+    }
+}
+
+void RobotsFormation::setAll(const dReal *xx, const dReal *yy, int count)
+{
+    x.assign(xx, xx + count);
+    y.assign(yy, yy + count);
+    fit();
+}
+
+void RobotsFormation::fit()
+{
+    const size_t count = 2 * cfg->Robots_Count();
+    if (x.size() >= count)
+        return;
+    //resetRobots mirrors every spot for one of the teams
+    std::vector<std::pair<dReal, dReal>> taken;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        taken.emplace_back(x[i], y[i]);
+        taken.emplace_back(-x[i], y[i]);
+    }
+    while (x.size() < count)
     {
-        x[i] = xx[i];
-        y[i] = yy[i];
+        dReal xx, yy;
+        freeSpot(taken, xx, yy, true);
+        x.push_back(xx);
+        y.push_back(yy);
+        taken.emplace_back(xx, yy);
+        taken.emplace_back(-xx, yy);
     }
 }
 
@@ -1182,7 +1714,7 @@ RobotsFormation::RobotsFormation(int type, ConfigWidget *_cfg) : cfg(_cfg)
                                            3, 3.2, 3.4, 3.6, 3.8, 4.0};
         dReal teamPosY[MAX_ROBOT_COUNT] = {0.0, -0.75, 0.0, 0.75, 0.25, 0.0,
                                            1, 1, 1, 1, 1, 1};
-        setAll(teamPosX, teamPosY);
+        setAll(teamPosX, teamPosY, MAX_ROBOT_COUNT);
     }
     if (type == 1) // formation 1
     {
@@ -1190,7 +1722,7 @@ RobotsFormation::RobotsFormation(int type, ConfigWidget *_cfg) : cfg(_cfg)
                                            3.2, 3.2, 3.2, 3.2, 3.2, 3.2};
         dReal teamPosY[MAX_ROBOT_COUNT] = {1.12, 0.0, -1.12, 0.0, 0.0, 0.0,
                                            0.75, -0.75, 1.5, -1.5, 2.25, -2.25};
-        setAll(teamPosX, teamPosY);
+        setAll(teamPosX, teamPosY, MAX_ROBOT_COUNT);
     }
     if (type == 2) // formation 2
     {
@@ -1198,19 +1730,19 @@ RobotsFormation::RobotsFormation(int type, ConfigWidget *_cfg) : cfg(_cfg)
                                            2, 2, 2, 2, 2, 2};
         dReal teamPosY[MAX_ROBOT_COUNT] = {0.0, -0.20, 0.20, 0.0, 2.25, -2.25,
                                            0.75, -0.75, 1.5, -1.5, 2.25, -2.25};
-        setAll(teamPosX, teamPosY);
+        setAll(teamPosX, teamPosY, MAX_ROBOT_COUNT);
     }
     if (type == 3) // div a
     {
-        dReal teamPosX[MAX_ROBOT_COUNT] = {0.30, 0.45, 0.45, 0.7, 1.1, -0.30, -0.45, -0.45, -0.7, -1.1, 0.0, 0.0};
-        dReal teamPosY[MAX_ROBOT_COUNT] = {0.0, 0.2, -0.2, 0.0, 0.0, 0.0, 0.2, -0.2, 0.0, 0.0, 0.0, 0.0};
-        setAll(teamPosX, teamPosY);
+        dReal teamPosX[10] = {0.30, 0.45, 0.45, 0.7, 1.1, -0.30, -0.45, -0.45, -0.7, -1.1};
+        dReal teamPosY[10] = {0.0, 0.2, -0.2, 0.0, 0.0, 0.0, 0.2, -0.2, 0.0, 0.0};
+        setAll(teamPosX, teamPosY, 10);
     }
     if (type == 4) // div b
     {
-        dReal teamPosX[MAX_ROBOT_COUNT] = {0.25, 0.5, 0.7, -0.25, -0.5, -0.7, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-        dReal teamPosY[MAX_ROBOT_COUNT] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-        setAll(teamPosX, teamPosY);
+        dReal teamPosX[6] = {0.25, 0.5, 0.7, -0.25, -0.5, -0.7};
+        dReal teamPosY[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        setAll(teamPosX, teamPosY, 6);
     }
     if (type == -1) // outside
     {
@@ -1218,7 +1750,7 @@ RobotsFormation::RobotsFormation(int type, ConfigWidget *_cfg) : cfg(_cfg)
                                            2.8, 3.2, 3.6, 4.0, 4.4, 4.8};
         dReal teamPosY[MAX_ROBOT_COUNT] = {-3.4, -3.4, -3.4, -3.4, -3.4, -3.4,
                                            -3.4, -3.4, -3.4, -3.4, -3.4, -3.4};
-        setAll(teamPosX, teamPosY);
+        setAll(teamPosX, teamPosY, MAX_ROBOT_COUNT);
     }
 }
 
@@ -1228,6 +1760,7 @@ void RobotsFormation::loadFromFile(const QString &filename)
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
         return;
     QTextStream in(&file);
+    fit();
     int k;
     for (k = 0; k < cfg->Robots_Count(); k++)
         x[k] = y[k] = 0;
@@ -1251,8 +1784,9 @@ void RobotsFormation::loadFromFile(const QString &filename)
     }
 }
 
-void RobotsFormation::resetRobots(CRobot **r, int team)
+void RobotsFormation::resetRobots(const std::vector<CRobot *> &r, int team)
 {
+    fit();
     dReal dir = -1;
     if (team == 1)
         dir = 1;
@@ -1263,131 +1797,3 @@ void RobotsFormation::resetRobots(CRobot **r, int team)
     }
 }
 
-//// Copy & pasted from http://www.dreamincode.net/code/snippet1446.htm
-/******************************************************************************/
-/* randn()
- *
- * Normally (Gaussian) distributed random numbers, using the Box-Muller
- * transformation.  This transformation takes two uniformly distributed deviates
- * within the unit circle, and transforms them into two independently
- * distributed normal deviates.  Utilizes the internal rand() function; this can
- * easily be changed to use a better and faster RNG.
- *
- * The parameters passed to the function are the mean and standard deviation of
- * the desired distribution.  The default values used, when no arguments are
- * passed, are 0 and 1 - the standard normal distribution.
- *
- *
- * Two functions are provided:
- *
- * The first uses the so-called polar version of the B-M transformation, using
- * multiple calls to a uniform RNG to ensure the initial deviates are within the
- * unit circle.  This avoids making any costly trigonometric function calls.
- *
- * The second makes only a single set of calls to the RNG, and calculates a
- * position within the unit circle with two trigonometric function calls.
- *
- * The polar version is generally superior in terms of speed; however, on some
- * systems, the optimization of the math libraries may result in better
- * performance of the second.  Try it out on the target system to see which
- * works best for you.  On my test machine (Athlon 3800+), the non-trig version
- * runs at about 3x10^6 calls/s; while the trig version runs at about
- * 1.8x10^6 calls/s (-O2 optimization).
- *
- *
- * Example calls:
- * randn_notrig();	//returns normal deviate with mean=0.0, std. deviation=1.0
- * randn_notrig(5.2,3.0);	//returns deviate with mean=5.2, std. deviation=3.0
- *
- *
- * Dependencies - requires <cmath> for the sqrt(), sin(), and cos() calls, and a
- * #defined value for PI.
- */
-
-/******************************************************************************/
-//	"Polar" version without trigonometric calls
-dReal randn_notrig(dReal mu, dReal sigma)
-{
-    if (sigma == 0)
-        return mu;
-    static bool deviateAvailable = false; //	flag
-    static dReal storedDeviate;           //	deviate from previous calculation
-    dReal polar, rsquared, var1, var2;
-
-    //	If no deviate has been stored, the polar Box-Muller transformation is
-    //	performed, producing two independent normally-distributed random
-    //	deviates.  One is stored for the next round, and one is returned.
-    if (!deviateAvailable)
-    {
-
-        //	choose pairs of uniformly distributed deviates, discarding those
-        //	that don't fall within the unit circle
-        do
-        {
-            var1 = 2.0 * (dReal(rand()) / dReal(RAND_MAX)) - 1.0;
-            var2 = 2.0 * (dReal(rand()) / dReal(RAND_MAX)) - 1.0;
-            rsquared = var1 * var1 + var2 * var2;
-        } while (rsquared >= 1.0 || rsquared == 0.0);
-
-        //	calculate polar tranformation for each deviate
-        polar = sqrt(-2.0 * log(rsquared) / rsquared);
-
-        //	store first deviate and set flag
-        storedDeviate = var1 * polar;
-        deviateAvailable = true;
-
-        //	return second deviate
-        return var2 * polar * sigma + mu;
-    }
-
-    //	If a deviate is available from a previous call to this function, it is
-    //	returned, and the flag is set to false.
-    else
-    {
-        deviateAvailable = false;
-        return storedDeviate * sigma + mu;
-    }
-}
-
-/******************************************************************************/
-//	Standard version with trigonometric calls
-#define PI 3.14159265358979323846
-
-dReal randn_trig(dReal mu, dReal sigma)
-{
-    static bool deviateAvailable = false; //	flag
-    static dReal storedDeviate;           //	deviate from previous calculation
-    dReal dist, angle;
-
-    //	If no deviate has been stored, the standard Box-Muller transformation is
-    //	performed, producing two independent normally-distributed random
-    //	deviates.  One is stored for the next round, and one is returned.
-    if (!deviateAvailable)
-    {
-
-        //	choose a pair of uniformly distributed deviates, one for the
-        //	distance and one for the angle, and perform transformations
-        dist = sqrt(-2.0 * log(dReal(rand()) / dReal(RAND_MAX)));
-        angle = 2.0 * PI * (dReal(rand()) / dReal(RAND_MAX));
-
-        //	calculate and store first deviate and set flag
-        storedDeviate = dist * cos(angle);
-        deviateAvailable = true;
-
-        //	calculate return second deviate
-        return dist * sin(angle) * sigma + mu;
-    }
-
-    //	If a deviate is available from a previous call to this function, it is
-    //	returned, and the flag is set to false.
-    else
-    {
-        deviateAvailable = false;
-        return storedDeviate * sigma + mu;
-    }
-}
-
-dReal rand0_1()
-{
-    return (dReal)(rand()) / (dReal)(RAND_MAX);
-}
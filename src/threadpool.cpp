@@ -0,0 +1,100 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int threads)
+{
+    current = nullptr;
+    job_count = next_job = busy = 0;
+    generation = 0;
+    stopping = false;
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::worker, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : workers)
+        t.join();
+}
+
+int ThreadPool::size() const
+{
+    return static_cast<int>(workers.size()) + 1;
+}
+
+void ThreadPool::runJobs()
+{
+    //called with the mutex held, releases it while a job runs
+    std::unique_lock<std::mutex> lock(mutex, std::adopt_lock);
+    while (next_job < job_count)
+    {
+        int i = next_job++;
+        busy++;
+        lock.unlock();
+        (*current)(i);
+        lock.lock();
+        busy--;
+    }
+    if (busy == 0)
+        done.notify_all();
+    lock.release();
+}
+
+void ThreadPool::worker()
+{
+    unsigned seen = 0;
+    mutex.lock();
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mutex, std::adopt_lock);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        lock.release();
+        if (stopping)
+            break;
+        seen = generation;
+        runJobs();
+    }
+    mutex.unlock();
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& job)
+{
+    if (workers.empty() || count <= 1)
+    {
+        for (int i = 0; i < count; i++)
+            job(i);
+        return;
+    }
+    mutex.lock();
+    current = &job;
+    job_count = count;
+    next_job = 0;
+    generation++;
+    wake.notify_all();
+    runJobs();
+    std::unique_lock<std::mutex> lock(mutex, std::adopt_lock);
+    done.wait(lock, [&] { return next_job >= job_count && busy == 0; });
+    current = nullptr;
+}
@@ -0,0 +1,123 @@
+/*
+grSim - RoboCup Small Size Soccer Robots Simulator
+Copyright (C) 2011, Parsian Robotic Center (eew.aut.ac.ir/~parsian/grsim)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vecsslworld.h"
+
+#include <cmath>
+
+VecSSLWorld::VecSSLWorld(int count, ConfigWidget *_cfg, RobotsFormation *form, int threads)
+    : pool(threads)
+{
+    cfg = _cfg;
+    worlds.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        worlds.push_back(new SSLWorld(nullptr, cfg, form));
+        //distinct but reproducible noise per world
+        if (cfg->Seed() != 0)
+            worlds.back()->setSeed(cfg->Seed() + i);
+    }
+}
+
+VecSSLWorld::~VecSSLWorld()
+{
+    for (auto &w : worlds)
+        delete w;
+}
+
+int VecSSLWorld::count() const
+{
+    return static_cast<int>(worlds.size());
+}
+
+int VecSSLWorld::actionSize() const
+{
+    return cfg->Robots_Count() * 2 * 2;
+}
+
+int VecSSLWorld::observationSize() const
+{
+    return VEC_BALL_OBS_SIZE + cfg->Robots_Count() * 2 * VEC_ROBOT_OBS_SIZE;
+}
+
+SSLWorld *VecSSLWorld::world(int i)
+{
+    return worlds[i];
+}
+
+void VecSSLWorld::applyActions(SSLWorld *w, const double *actions)
+{
+    for (int k = 0; k < cfg->Robots_Count() * 2; k++)
+    {
+        const double left = actions[2 * k];
+        const double right = actions[2 * k + 1];
+        if (std::isnan(left) || std::isnan(right))
+            continue;
+        //same sign convention as SSLWorld::recvActions
+        w->robots[k]->setSpeed(0, -1 * left);
+        w->robots[k]->setSpeed(1, right);
+    }
+}
+
+void VecSSLWorld::observeWorld(SSLWorld *w, float *obs)
+{
+    dReal x, y, z;
+    w->ball->getBodyPosition(x, y, z);
+    const dReal *ball_vel = dBodyGetLinearVel(w->ball->body);
+    *obs++ = x;
+    *obs++ = y;
+    *obs++ = z;
+    *obs++ = ball_vel[0];
+    *obs++ = ball_vel[1];
+    for (int k = 0; k < cfg->Robots_Count() * 2; k++)
+    {
+        CRobot *r = w->robots[k];
+        r->getXY(x, y);
+        const dReal *vel = dBodyGetLinearVel(r->chassis->body);
+        const dReal *ang = dBodyGetAngularVel(r->chassis->body);
+        *obs++ = x;
+        *obs++ = y;
+        *obs++ = r->getDir() * M_PI / 180.0;
+        *obs++ = vel[0];
+        *obs++ = vel[1];
+        *obs++ = ang[2];
+        *obs++ = r->on ? 1.0f : 0.0f;
+    }
+}
+
+void VecSSLWorld::observe(float *observations)
+{
+    const int obs_size = observationSize();
+    pool.parallelFor(count(), [&](int i) {
+        observeWorld(worlds[i], observations + i * obs_size);
+    });
+}
+
+void VecSSLWorld::step(const double *actions, float *observations)
+{
+    const int act_size = actionSize();
+    const int obs_size = observationSize();
+    const dReal dt = cfg->DeltaTime();
+    pool.parallelFor(count(), [&](int i) {
+        SSLWorld *w = worlds[i];
+        applyActions(w, actions + i * act_size);
+        w->simStep(dt);
+        if (observations != nullptr)
+            observeWorld(w, observations + i * obs_size);
+    });
+}